@@ -9,6 +9,14 @@
 #define INC_5BUTTONS_H_
 
 #include "stdbool.h"
+#include "stdint.h"
+
+/* Presses the UI did not take yet, power of two */
+#define BUTTONS_QUEUE_SIZE 16U
+#define BUTTONS_NO_BUTTONS 5U
+/* Level has to be stable this long after the last edge */
+#define BUTTONS_DEBOUNCE_MS 20U
+#define BUTTONS_LONG_PRESS_MS 1000U
 
 typedef enum buttons_state
 {
@@ -20,16 +28,52 @@ typedef enum buttons_state
   ENTER_FLAG
 } buttons_state_t;
 
-typedef struct button_flags
+/* Bit of the button in masks */
+#define BUTTON_MASK(button) (1U << ((button) - LEFT_FLAG))
+#define BUTTONS_ARROWS_MASK                                                   \
+  (BUTTON_MASK(LEFT_FLAG) | BUTTON_MASK(RIGHT_FLAG) | BUTTON_MASK(DOWN_FLAG) | \
+   BUTTON_MASK(UP_FLAG))
+
+typedef enum button_edge
+{
+  BUTTON_PRESSED,
+  BUTTON_RELEASED,
+  /* key is held - handled as one more press */
+  BUTTON_REPEAT,
+  BUTTON_LONG_PRESS,
+  /* button pressed while other ones are held, see held_mask */
+  BUTTON_CHORD
+} button_edge_t;
+
+/*
+ * Debounced edge (or held key event) of one button
+ */
+typedef struct button_event
+{
+  buttons_state_t button;
+  button_edge_t edge;
+  uint8_t held_mask;
+  uint32_t tick;
+} button_event_t;
+
+/*
+ * Held key repeats after delay_ms, every next repeat comes after
+ * period_percent of the previous period, down to min_period_ms
+ */
+typedef struct buttons_repeat_config
 {
-  bool left_flag;
-  bool right_flag;
-  bool down_flag;
-  bool up_flag;
-  bool enter_flag;
-} button_flags_t;
+  uint16_t delay_ms;
+  uint16_t start_period_ms;
+  uint16_t min_period_ms;
+  uint8_t period_percent;
+  uint8_t button_mask;
+} buttons_repeat_config_t;
 
+bool buttons_get_event(button_event_t *p_event);
 buttons_state_t buttons_get_pending_flag(void);
 void buttons_reset_flag(buttons_state_t state_flag);
+uint32_t buttons_get_worst_latency(void);
+void buttons_set_repeat(const buttons_repeat_config_t *p_config);
+void buttons_tick(void);
 
 #endif /* INC_5BUTTONS_H_ */
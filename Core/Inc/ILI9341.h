@@ -17,6 +17,20 @@
 #define ILI9341_HAL_OPTIMIZE	1
 #define ILI9341_ROTATION		1 // 0 - 0 deg, 1 - 90 deg, 2 - 180 deg, 270 deg
 
+// Init waits [ms]
+#define ILI9341_RESET_PULSE_MS		10
+#define ILI9341_RESET_WAIT_MS		10  // datasheet: 5 ms after HW reset
+#define ILI9341_SWRESET_WAIT_MS		120
+#define ILI9341_SLPOUT_CMD_MS		5   // SLPOUT to next command
+#define ILI9341_SLPOUT_DISPON_MS	120 // SLPOUT to display on (supply settled)
+
+typedef enum
+{
+  ILI9341_INIT_BUSY = 0,       // controller is waking up
+  ILI9341_INIT_GRAM_READY = 1, // GRAM can be written, display is still off
+  ILI9341_INIT_DONE = 2        // display is on
+} ILI9341_InitState_t;
+
 #if(ILI9341_USE_CS == 1)
 #define ILI9341_CS_LOW			HAL_GPIO_WritePin(TFT_CS_GPIO_Port, TFT_CS_Pin, GPIO_PIN_RESET)
 #define ILI9341_CS_HIGH			HAL_GPIO_WritePin(TFT_CS_GPIO_Port, TFT_CS_Pin, GPIO_PIN_SET)
@@ -126,8 +140,13 @@
 
 
 void ILI9341_Init(SPI_HandleTypeDef *hspi);
+void ILI9341_InitStart(SPI_HandleTypeDef *hspi);
+ILI9341_InitState_t ILI9341_InitStep(void);
+uint32_t ILI9341_InitWakeTick(void);
 void ILI9341_WritePixel(int16_t x, int16_t y, uint16_t color);
 void ILI9341_ClearDisplay(uint16_t color);
+void ILI9341_FillArea(uint16_t x, uint16_t y, uint16_t w, uint16_t h,
+                      uint16_t color);
 void ILI9341_DrawImage(int x, int y, const uint8_t *img, uint16_t w, uint16_t h);
 void ILI9341_SetRotation(uint8_t Rotation);
 
@@ -5,16 +5,22 @@
  *      Author: ROJEK
  */
 #include "stdint.h"
-#include "xgb_comm.h"
 
 #ifndef INC_RINGBUFFER_H_
 #define INC_RINGBUFFER_H_
-#define RING_BUFFER_SIZE MAX_FRAME_SIZE
 
+/*
+ * Single producer / single consumer queue (e.g. ISR or DMA -> main loop).
+ * Capacity has to be a power of two, Head and Tail are free running and
+ * are masked only when the buffer is accessed. Head is written only by the
+ * producer, Tail only by the consumer, so no locking is needed.
+ */
 typedef struct{
-	uint8_t buffer[RING_BUFFER_SIZE];
-	uint16_t Head;
-	uint16_t Tail;
+	uint8_t *Buffer;
+	uint16_t ElementSize;
+	uint16_t Mask;
+	volatile uint16_t Head;
+	volatile uint16_t Tail;
 }Ringbuffer_t;
 
 typedef enum
@@ -23,8 +29,24 @@ typedef enum
 	RB_ERROR = 1
 }RB_Status;
 
-RB_Status RB_Write(Ringbuffer_t *buffer, uint8_t value);
-RB_Status RB_Read(Ringbuffer_t *buffer, uint8_t *value);
+RB_Status RB_Init(Ringbuffer_t *buffer, void *storage, uint16_t element_size,
+		uint16_t capacity);
+
+/* producer side */
+RB_Status RB_Write(Ringbuffer_t *buffer, const void *element);
+uint16_t RB_WriteSpan(Ringbuffer_t *buffer, const void *elements,
+		uint16_t count);
+uint16_t RB_GetWriteRegion(Ringbuffer_t *buffer, void **region);
+RB_Status RB_Commit(Ringbuffer_t *buffer, uint16_t count);
+
+/* consumer side */
+RB_Status RB_Read(Ringbuffer_t *buffer, void *element);
+uint16_t RB_ReadSpan(Ringbuffer_t *buffer, void *elements, uint16_t count);
+uint16_t RB_PeekContiguous(Ringbuffer_t *buffer, void **region);
+void RB_Consume(Ringbuffer_t *buffer, uint16_t count);
 void RB_Flush(Ringbuffer_t *buffer);
 
+uint16_t RB_Count(const Ringbuffer_t *buffer);
+uint16_t RB_Free(const Ringbuffer_t *buffer);
+
 #endif /* INC_RINGBUFFER_H_ */
@@ -8,107 +8,306 @@
 #include "5buttons.h"
 
 #include "main.h"
+#include "ringbuffer.h"
+#include "stddef.h"
 
-#define BTN_LEFT BUTTON_LEFT_Pin
-#define BTN_RIGHT BUTTON_RIGHT_Pin
-#define BTN_DOWN BUTTON_DOWN_Pin
-#define BTN_UP BUTTON_UP_Pin
-#define BTN_ENTER BUTTON_ENTER_Pin
+#include "hmi_event.h"
 
-static volatile button_flags_t flags;
+/*
+ * Button of each EXTI line, buttons pull the line low
+ */
+typedef struct button_pin
+{
+  uint16_t pin;
+  GPIO_TypeDef *p_port;
+  buttons_state_t button;
+} button_pin_t;
 
-void set_button_flag(uint16_t GPIO_Pin)
+/*
+ * Debounce and hold state of one button. EXTI only notes the edge, the
+ * level is taken by SysTick once it is stable.
+ */
+typedef struct button_debounce
 {
-  switch (GPIO_Pin)
-    {
-    case (BTN_LEFT):
-      flags.left_flag = true;
-      break;
+  volatile uint32_t first_edge_tick;
+  volatile uint32_t edge_tick;
+  volatile bool bouncing;
+  bool pressed;
+  uint32_t press_tick;
+  uint32_t next_repeat_tick;
+  uint16_t repeat_period;
+  bool long_press_sent;
+} button_debounce_t;
+
+/* Table is in the order of buttons_state_t, index is button - LEFT_FLAG */
+static const button_pin_t button_pins[BUTTONS_NO_BUTTONS] = {
+    {BUTTON_LEFT_Pin, BUTTON_LEFT_GPIO_Port, LEFT_FLAG},
+    {BUTTON_RIGHT_Pin, BUTTON_RIGHT_GPIO_Port, RIGHT_FLAG},
+    {BUTTON_DOWN_Pin, BUTTON_DOWN_GPIO_Port, DOWN_FLAG},
+    {BUTTON_UP_Pin, BUTTON_UP_GPIO_Port, UP_FLAG},
+    {BUTTON_ENTER_Pin, BUTTON_ENTER_GPIO_Port, ENTER_FLAG}};
 
-    case (BTN_RIGHT):
-      flags.right_flag = true;
-      break;
+/* Events are pushed only from SysTick, so the queue has a single
+ * producer */
+static button_event_t event_storage[BUTTONS_QUEUE_SIZE];
+static Ringbuffer_t event_queue = {.Buffer = (uint8_t *)event_storage,
+                                   .ElementSize = sizeof(button_event_t),
+                                   .Mask = BUTTONS_QUEUE_SIZE - 1U};
+static uint32_t worst_latency;
 
-    case (BTN_DOWN):
-      flags.down_flag = true;
-      break;
+static button_debounce_t debounce[BUTTONS_NO_BUTTONS];
+static uint8_t held_mask;
+/* address digit 0 -> 9 takes about one second of holding the key */
+static buttons_repeat_config_t repeat_config = {.delay_ms = 400U,
+                                                .start_period_ms = 200U,
+                                                .min_period_ms = 40U,
+                                                .period_percent = 80U,
+                                                .button_mask =
+                                                    BUTTONS_ARROWS_MASK};
 
-    case (BTN_UP):
-      flags.up_flag = true;
-      break;
+static bool is_bounce_over(button_debounce_t *p_button, uint32_t now);
+static void take_stable_level(uint8_t index);
+static void check_held_button(uint8_t index, uint32_t now);
+static void push_button_event(uint8_t index, button_edge_t edge,
+                              uint32_t tick);
+static const button_event_t *peek_next_press(void);
 
-    case (BTN_ENTER):
-      flags.enter_flag = true;
-      break;
+/*
+ * Events in the order they came, presses, releases and held key events
+ */
+bool buttons_get_event(button_event_t *p_event)
+{
+  return (RB_OK == RB_Read(&event_queue, p_event));
+}
+
+/*
+ * Oldest press (or repeat) that was not handled yet, other events before it
+ * are dropped
+ */
+buttons_state_t buttons_get_pending_flag(void)
+{
+  const button_event_t *p_event = peek_next_press();
+
+  return (NULL != p_event) ? p_event->button : IDLE;
+}
+
+/*
+ * Press is taken by the UI - time from the edge to now is its latency
+ */
+void buttons_reset_flag(buttons_state_t state_flag)
+{
+  const button_event_t *p_event = peek_next_press();
+
+  if (NULL == p_event || state_flag != p_event->button)
+    {
+      return;
+    }
 
-    default:
-      break;
-      // different gpio
+  if (HAL_GetTick() - p_event->tick > worst_latency)
+    {
+      worst_latency = HAL_GetTick() - p_event->tick;
     }
 
+  RB_Consume(&event_queue, 1);
+
   return;
 }
 
-buttons_state_t buttons_get_pending_flag(void)
+uint32_t buttons_get_worst_latency(void)
 {
-  buttons_state_t active_button = IDLE;
+  return worst_latency;
+}
 
-  if (flags.left_flag)
+/*
+ * Repeat is safe to change from the main loop, SysTick reads whole fields
+ */
+void buttons_set_repeat(const buttons_repeat_config_t *p_config)
+{
+  __disable_irq();
+  repeat_config = *p_config;
+  __enable_irq();
+
+  return;
+}
+
+/*
+ * Called from SysTick every millisecond - debounce, repeat and long press
+ * run on this one timer
+ */
+void buttons_tick(void)
+{
+  uint32_t now = HAL_GetTick();
+
+  for (uint8_t i = 0; i < BUTTONS_NO_BUTTONS; i++)
+    {
+      if (true == is_bounce_over(&debounce[i], now))
+        {
+          take_stable_level(i);
+        }
+
+      if (true == debounce[i].pressed)
+        {
+          check_held_button(i, now);
+        }
+    }
+
+  return;
+}
+
+/*
+ * Every edge restarts the debounce time, the first one of the burst is the
+ * time of the press
+ */
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+  for (uint8_t i = 0; i < BUTTONS_NO_BUTTONS; i++)
     {
-      active_button = LEFT_FLAG;
+      if (GPIO_Pin == button_pins[i].pin)
+        {
+          if (false == debounce[i].bouncing)
+            {
+              debounce[i].first_edge_tick = HAL_GetTick();
+            }
+
+          debounce[i].edge_tick = HAL_GetTick();
+          debounce[i].bouncing = true;
+          break;
+        }
     }
-  else if (flags.right_flag)
+
+  // different gpio
+  return;
+}
+
+/*
+ * EXTI preempts SysTick - check and clear is done with interrupts off, so
+ * an edge coming just now is not lost
+ */
+static bool is_bounce_over(button_debounce_t *p_button, uint32_t now)
+{
+  bool bounce_over = false;
+
+  __disable_irq();
+
+  if (true == p_button->bouncing &&
+      now - p_button->edge_tick >= BUTTONS_DEBOUNCE_MS)
     {
-      active_button = RIGHT_FLAG;
+      p_button->bouncing = false;
+      bounce_over = true;
     }
-  else if (flags.down_flag)
+
+  __enable_irq();
+
+  return bounce_over;
+}
+
+/*
+ * Burst that ends in the same level (spike) gives no event
+ */
+static void take_stable_level(uint8_t index)
+{
+  button_debounce_t *p_button = &debounce[index];
+  buttons_state_t button = button_pins[index].button;
+  bool pressed = (GPIO_PIN_RESET == HAL_GPIO_ReadPin(button_pins[index].p_port,
+                                                     button_pins[index].pin));
+
+  if (pressed == p_button->pressed)
     {
-      active_button = DOWN_FLAG;
+      return;
     }
-  else if (flags.up_flag)
+
+  p_button->pressed = pressed;
+
+  if (false == pressed)
     {
-      active_button = UP_FLAG;
+      held_mask &= (uint8_t)~BUTTON_MASK(button);
+      push_button_event(index, BUTTON_RELEASED, HAL_GetTick());
+      return;
     }
-  else if (flags.enter_flag)
+
+  held_mask |= (uint8_t)BUTTON_MASK(button);
+  p_button->press_tick = p_button->first_edge_tick;
+  p_button->next_repeat_tick = p_button->press_tick + repeat_config.delay_ms;
+  p_button->repeat_period = repeat_config.start_period_ms;
+  p_button->long_press_sent = false;
+
+  push_button_event(index, BUTTON_PRESSED, p_button->press_tick);
+
+  if (BUTTON_MASK(button) != held_mask)
     {
-      active_button = ENTER_FLAG;
+      push_button_event(index, BUTTON_CHORD, p_button->press_tick);
     }
 
-  return active_button;
+  return;
 }
 
-void buttons_reset_flag(buttons_state_t state_flag)
+/*
+ * Repeat only when the key is held alone - chord is not a fast scroll
+ */
+static void check_held_button(uint8_t index, uint32_t now)
 {
-  switch (state_flag)
-    {
-    case (LEFT_FLAG):
-      flags.left_flag = false;
-      break;
+  button_debounce_t *p_button = &debounce[index];
+  uint8_t mask = (uint8_t)BUTTON_MASK(button_pins[index].button);
 
-    case (RIGHT_FLAG):
-      flags.right_flag = false;
-      break;
+  if (false == p_button->long_press_sent &&
+      now - p_button->press_tick >= BUTTONS_LONG_PRESS_MS)
+    {
+      p_button->long_press_sent = true;
+      push_button_event(index, BUTTON_LONG_PRESS, now);
+    }
 
-    case (DOWN_FLAG):
-      flags.down_flag = false;
-      break;
+  if (0 == (repeat_config.button_mask & mask) || mask != held_mask ||
+      (int32_t)(now - p_button->next_repeat_tick) < 0)
+    {
+      return;
+    }
 
-    case (UP_FLAG):
-      flags.up_flag = false;
-      break;
+  push_button_event(index, BUTTON_REPEAT, now);
 
-    case (ENTER_FLAG):
-      flags.enter_flag = false;
-      break;
+  p_button->next_repeat_tick = now + p_button->repeat_period;
+  p_button->repeat_period =
+      (uint16_t)((p_button->repeat_period * repeat_config.period_percent) /
+                 100U);
 
-    case (IDLE):
-    default:
-      break;
+  if (p_button->repeat_period < repeat_config.min_period_ms)
+    {
+      p_button->repeat_period = repeat_config.min_period_ms;
     }
+
+  return;
 }
 
-void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+/*
+ * Full queue drops the newest event - operator pressed 16 times faster than
+ * the screen could follow
+ */
+static void push_button_event(uint8_t index, button_edge_t edge,
+                              uint32_t tick)
 {
-  set_button_flag(GPIO_Pin);
+  button_event_t event = {.button = button_pins[index].button,
+                          .edge = edge,
+                          .held_mask = held_mask,
+                          .tick = tick};
+
+  RB_Write(&event_queue, &event);
+  ev_post(EV_BUTTON);
+
   return;
 }
+
+static const button_event_t *peek_next_press(void)
+{
+  button_event_t *p_event;
+
+  while (0 != RB_PeekContiguous(&event_queue, (void **)&p_event))
+    {
+      if (BUTTON_PRESSED == p_event->edge || BUTTON_REPEAT == p_event->edge)
+        {
+          return p_event;
+        }
+
+      RB_Consume(&event_queue, 1);
+    }
+
+  return NULL;
+}
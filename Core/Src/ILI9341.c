@@ -10,8 +10,26 @@
 
 SPI_HandleTypeDef *Tft_hspi;
 
-// Delay for the functions
-static void ILI9341_Delay(uint32_t ms) { HAL_Delay(ms); }
+// Init steps, waits between them are timed with HAL tick instead of delays
+typedef enum
+{
+  ILI9341_PHASE_RESET = 0,
+  ILI9341_PHASE_COMMANDS = 1,
+  ILI9341_PHASE_SLEEP_OUT = 2,
+  ILI9341_PHASE_DISPLAY_OFF = 3,
+  ILI9341_PHASE_DISPLAY_ON = 4
+} ILI9341_InitPhase_t;
+
+static ILI9341_InitPhase_t InitPhase;
+static uint32_t InitWaitStart;
+static uint32_t InitWaitMs;
+static uint32_t SleepOutTick;
+
+static void ILI9341_InitWait(uint32_t ms)
+{
+  InitWaitStart = HAL_GetTick();
+  InitWaitMs = ms;
+}
 
 // Transmit data to ILI controller
 static void ILI9341_SendTFT(uint8_t *Data, uint8_t Lenght)
@@ -213,10 +231,18 @@ void ILI9341_DrawImage(int x, int y, const uint8_t *img, uint16_t w, uint16_t h)
 // Clear whole dipslay with a color
 void ILI9341_ClearDisplay(uint16_t color)
 {
-  uint32_t Lenght = ILI9341_TFTWIDTH * ILI9341_TFTHEIGHT;
+  ILI9341_FillArea(0, 0, ILI9341_TFTWIDTH, ILI9341_TFTHEIGHT, color);
+}
 
-  // set window for whole screen
-  ILI9341_SetAddrWindow(0, 0, ILI9341_TFTWIDTH, ILI9341_TFTHEIGHT);
+// Fill rectangle with a color - one window for the whole area, not a window
+// per pixel like GFX_DrawFillRectangle
+void ILI9341_FillArea(uint16_t x, uint16_t y, uint16_t w, uint16_t h,
+                      uint16_t color)
+{
+  uint32_t Lenght = (uint32_t)w * h;
+
+  // set window for the area
+  ILI9341_SetAddrWindow(x, y, w, h);
 
   // send command that we are writing to RAM
   ILI9341_SendCommand(ILI9341_RAMWR);
@@ -381,22 +407,25 @@ static const uint8_t initcmd[] = {
     0x31,
     0x36,
     0x0F,
-    ILI9341_SLPOUT,
-    0x80, // Exit Sleep
-    ILI9341_DISPON,
-    0x80, // Display on
-    0x00  // End of list
+    0x00 // End of list, SLPOUT and DISPON are timed by ILI9341_InitStep
 };
 
+// Blocking init, the panel is on when it returns
 void ILI9341_Init(SPI_HandleTypeDef *hspi)
 {
-  // assign correct spi
-  Tft_hspi = hspi;
+  ILI9341_InitStart(hspi);
 
-  // prepare data
+  while (ILI9341_INIT_DONE != ILI9341_InitStep())
+    {
+    }
+}
 
-  uint8_t cmd, x, numArgs;
-  const uint8_t *addr = initcmd;
+// Starts the reset, ILI9341_InitStep does the rest - the CPU is free during
+// the waits of the controller
+void ILI9341_InitStart(SPI_HandleTypeDef *hspi)
+{
+  // assign correct spi
+  Tft_hspi = hspi;
 
 #if (ILI9341_HAL_OPTIMIZE == 1)
   __HAL_SPI_ENABLE(hspi);
@@ -405,39 +434,76 @@ void ILI9341_Init(SPI_HandleTypeDef *hspi)
 // if hardware reset is defined
 #if (ILI9341_USE_HW_RESET == 1)
   ILI9341_RST_LOW;
-  ILI9341_Delay(10);
-  ILI9341_RST_HIGH;
-  ILI9341_Delay(10);
+  ILI9341_InitWait(ILI9341_RESET_PULSE_MS);
+  InitPhase = ILI9341_PHASE_RESET;
 #else
   ILI9341_SendCommand(ILI9341_SWRESET); // Engage software reset
-  ILI9341_Delay(150);
+  ILI9341_InitWait(ILI9341_SWRESET_WAIT_MS);
+  InitPhase = ILI9341_PHASE_COMMANDS;
 #endif
+}
 
-  // As long as value under address is not 0 loop
-  while ((cmd = *(addr++)) > 0)
-    {
-      // assign value form address to x (second value that is number of data to
-      // be send)
-      x = *(addr++);
+// Call again at ILI9341_InitWakeTick or later. GRAM can be written from
+// ILI9341_INIT_GRAM_READY on, so the first frame is drawn while the
+// controller still wakes up and it is shown whole with DISPON.
+ILI9341_InitState_t ILI9341_InitStep(void)
+{
+  uint8_t cmd, numArgs;
+  const uint8_t *addr = initcmd;
 
-      // mask this value to maximum of 127
-      // 0x7F	0111 1111
-      // so if we send 0x80 as second argument then we just send command ->
-      // without data
-      numArgs = x & 0x7F;
+  if (HAL_GetTick() - InitWaitStart < InitWaitMs)
+    {
+      return (InitPhase >= ILI9341_PHASE_DISPLAY_OFF) ? ILI9341_INIT_GRAM_READY
+                                                      : ILI9341_INIT_BUSY;
+    }
 
-      // send command then array of data
-      ILI9341_SendCommandAndData(cmd, (uint8_t *)addr, numArgs);
+  switch (InitPhase)
+    {
+    case ILI9341_PHASE_RESET:
+      ILI9341_RST_HIGH;
+      ILI9341_InitWait(ILI9341_RESET_WAIT_MS);
+      InitPhase = ILI9341_PHASE_COMMANDS;
+      return ILI9341_INIT_BUSY;
+
+    case ILI9341_PHASE_COMMANDS:
+      // As long as value under address is not 0 loop
+      while ((cmd = *(addr++)) > 0)
+        {
+          // second value is number of data to be send
+          numArgs = *(addr++) & 0x7F;
 
-      // move adress to next command
-      addr += numArgs;
+          // send command then array of data
+          ILI9341_SendCommandAndData(cmd, (uint8_t *)addr, numArgs);
 
-      // if only command is sent then make a delay
-      if (x & 0x80)
-        {
-          ILI9341_Delay(150);
+          // move adress to next command
+          addr += numArgs;
         }
-    }
 
-  ILI9341_SetRotation(ILI9341_ROTATION);
+      ILI9341_SetRotation(ILI9341_ROTATION);
+
+      ILI9341_SendCommand(ILI9341_SLPOUT);
+      SleepOutTick = HAL_GetTick();
+      ILI9341_InitWait(ILI9341_SLPOUT_CMD_MS);
+      InitPhase = ILI9341_PHASE_SLEEP_OUT;
+      return ILI9341_INIT_BUSY;
+
+    case ILI9341_PHASE_SLEEP_OUT:
+      // display stays off until the supply settles, GRAM works already
+      InitWaitStart = SleepOutTick;
+      InitWaitMs = ILI9341_SLPOUT_DISPON_MS;
+      InitPhase = ILI9341_PHASE_DISPLAY_OFF;
+      return ILI9341_INIT_GRAM_READY;
+
+    case ILI9341_PHASE_DISPLAY_OFF:
+      ILI9341_SendCommand(ILI9341_DISPON);
+      InitPhase = ILI9341_PHASE_DISPLAY_ON;
+      return ILI9341_INIT_DONE;
+
+    case ILI9341_PHASE_DISPLAY_ON:
+    default:
+      return ILI9341_INIT_DONE;
+    }
 }
+
+// Tick of the next init step
+uint32_t ILI9341_InitWakeTick(void) { return InitWaitStart + InitWaitMs; }
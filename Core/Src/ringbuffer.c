@@ -7,39 +7,176 @@
 
 #include "ringbuffer.h"
 
-RB_Status RB_Read(Ringbuffer_t *buffer, uint8_t *value)
+#include "main.h"
+#include "string.h"
+
+static uint8_t *RB_ElementPtr(const Ringbuffer_t *buffer, uint16_t index)
 {
-	if(buffer->Head == buffer->Tail)
+	return &buffer->Buffer[(index & buffer->Mask) * buffer->ElementSize];
+}
+
+RB_Status RB_Init(Ringbuffer_t *buffer, void *storage, uint16_t element_size,
+		uint16_t capacity)
+{
+	// capacity has to be power of two so indexes can be masked,
+	// and half of index range so free running indexes do not alias
+	if ((0 == capacity) || (0 != (capacity & (capacity - 1)))
+			|| (capacity > 0x8000U) || (0 == element_size))
 	{
 		return RB_ERROR;
 	}
 
-	*value = buffer->buffer[buffer->Tail];
-
-	buffer->Tail = (buffer->Tail + 1) % RING_BUFFER_SIZE;
+	buffer->Buffer = (uint8_t*) storage;
+	buffer->ElementSize = element_size;
+	buffer->Mask = capacity - 1;
+	buffer->Head = 0;
+	buffer->Tail = 0;
 
 	return RB_OK;
 }
 
-RB_Status RB_Write(Ringbuffer_t *buffer, uint8_t value)
+uint16_t RB_Count(const Ringbuffer_t *buffer)
 {
+	return (uint16_t) (buffer->Head - buffer->Tail);
+}
 
-	uint16_t HeadTmp;
-	HeadTmp = (buffer->Head + 1) % RING_BUFFER_SIZE;
+uint16_t RB_Free(const Ringbuffer_t *buffer)
+{
+	return (uint16_t) (buffer->Mask + 1 - RB_Count(buffer));
+}
+
+RB_Status RB_Read(Ringbuffer_t *buffer, void *element)
+{
+	return (1 == RB_ReadSpan(buffer, element, 1)) ? RB_OK : RB_ERROR;
+}
 
-	if (HeadTmp == buffer->Tail)
+RB_Status RB_Write(Ringbuffer_t *buffer, const void *element)
+{
+	return (1 == RB_WriteSpan(buffer, element, 1)) ? RB_OK : RB_ERROR;
+}
+
+uint16_t RB_WriteSpan(Ringbuffer_t *buffer, const void *elements,
+		uint16_t count)
+{
+	const uint8_t *src = (const uint8_t*) elements;
+	uint16_t space = RB_Free(buffer);
+	uint16_t head_index = buffer->Head & buffer->Mask;
+	uint16_t first_part;
+
+	if (count > space)
+	{
+		count = space;
+	}
+
+	// copy in max two parts - till the end of buffer and from the beginning
+	first_part = buffer->Mask + 1 - head_index;
+	if (first_part > count)
+	{
+		first_part = count;
+	}
+
+	memcpy(RB_ElementPtr(buffer, head_index), src,
+			first_part * buffer->ElementSize);
+	memcpy(buffer->Buffer, src + (first_part * buffer->ElementSize),
+			(count - first_part) * buffer->ElementSize);
+
+	RB_Commit(buffer, count);
+
+	return count;
+}
+
+uint16_t RB_ReadSpan(Ringbuffer_t *buffer, void *elements, uint16_t count)
+{
+	uint8_t *dst = (uint8_t*) elements;
+	uint16_t used = RB_Count(buffer);
+	uint16_t tail_index = buffer->Tail & buffer->Mask;
+	uint16_t first_part;
+
+	// make sure data is read after the Head that published it
+	__DMB();
+
+	if (count > used)
+	{
+		count = used;
+	}
+
+	first_part = buffer->Mask + 1 - tail_index;
+	if (first_part > count)
+	{
+		first_part = count;
+	}
+
+	memcpy(dst, RB_ElementPtr(buffer, tail_index),
+			first_part * buffer->ElementSize);
+	memcpy(dst + (first_part * buffer->ElementSize), buffer->Buffer,
+			(count - first_part) * buffer->ElementSize);
+
+	RB_Consume(buffer, count);
+
+	return count;
+}
+
+/*
+ * Contiguous free region at Head, producer can fill it in place (e.g. DMA)
+ * and publish it with RB_Commit
+ */
+uint16_t RB_GetWriteRegion(Ringbuffer_t *buffer, void **region)
+{
+	uint16_t head_index = buffer->Head & buffer->Mask;
+	uint16_t till_end = buffer->Mask + 1 - head_index;
+	uint16_t space = RB_Free(buffer);
+
+	*region = RB_ElementPtr(buffer, head_index);
+
+	return (space < till_end) ? space : till_end;
+}
+
+/*
+ * Returns RB_ERROR if count does not fit in the free space - producer has
+ * overwritten unread elements (e.g. DMA ran ahead of the consumer), Head is
+ * left as it was
+ */
+RB_Status RB_Commit(Ringbuffer_t *buffer, uint16_t count)
+{
+	if (count > RB_Free(buffer))
 	{
 		return RB_ERROR;
 	}
 
-	buffer->buffer[buffer->Head] = value;
-	buffer->Head = HeadTmp;
+	// data has to be in memory before consumer sees new Head
+	__DMB();
+	buffer->Head = buffer->Head + count;
 
 	return RB_OK;
 }
 
+/*
+ * Contiguous readable region at Tail, consumer can parse it in place
+ * and release it with RB_Consume
+ */
+uint16_t RB_PeekContiguous(Ringbuffer_t *buffer, void **region)
+{
+	uint16_t tail_index = buffer->Tail & buffer->Mask;
+	uint16_t till_end = buffer->Mask + 1 - tail_index;
+	uint16_t used = RB_Count(buffer);
+
+	__DMB();
+	*region = RB_ElementPtr(buffer, tail_index);
+
+	return (used < till_end) ? used : till_end;
+}
+
+void RB_Consume(Ringbuffer_t *buffer, uint16_t count)
+{
+	// finish reading the data before producer may overwrite it
+	__DMB();
+	buffer->Tail = buffer->Tail + count;
+}
+
+/*
+ * Drop all unread elements, safe to call from the consumer side
+ */
 void RB_Flush(Ringbuffer_t *buffer)
 {
-	buffer->Head = 0;
-	buffer->Tail = 0;
+	buffer->Tail = buffer->Head;
 }
@@ -11,6 +11,24 @@
 #include "stdbool.h"
 #include "xgb_comm.h"
 
+/* Tiles are shown in pages of one screen, HMI_TILE_ROWS in each of the
+ * HMI_TILE_COLUMNS. Tile table takes 33 B of RAM per tile. */
+#define HMI_TILE_ROWS 5U
+#define HMI_TILE_COLUMNS 2U
+#define HMI_TILES_PER_PAGE (HMI_TILE_ROWS * HMI_TILE_COLUMNS)
+#define HMI_NO_PAGES 4U
+#define HMI_NO_TILES (HMI_TILES_PER_PAGE * HMI_NO_PAGES)
+
+/* Device address field of the edit menu, decimal digits - bit addresses
+ * reach bits 0 - 9 of a word, hex bit digits A - F can not be entered */
+#define HMI_ADDRESS_DIGITS 6U
+
+/* Runtime flags of a tile */
+#define HMI_TILE_CONFIGURED 0x01U
+#define HMI_TILE_WRITE_PENDING 0x02U
+/* value came from PLC and waits for the render task */
+#define HMI_TILE_REPAINT_PENDING 0x04U
+
 typedef uint8_t cursor;
 
 typedef enum hmi_change_screen
@@ -29,9 +47,21 @@ typedef enum hmi_state
   INIT_MAIN_MENU = 2,
   MAIN_MENU = 3,
   INIT_EDIT_MENU = 4,
-  EDIT_MENU = 5
+  EDIT_MENU = 5,
+  DRAW_FIRST_FRAME = 6,
+  TFT_DISPLAY_ON = 7
 } hmi_state_t;
 
+/* HAL ticks [ms after reset] of the start up, 0 - step not done yet */
+typedef struct hmi_boot_times
+{
+  uint32_t comm_start_tick;
+  uint32_t gram_ready_tick;
+  uint32_t first_frame_tick;
+  uint32_t display_on_tick;
+  uint32_t first_value_tick;
+} hmi_boot_times_t;
+
 typedef enum tile_function
 {
   READ = 0,
@@ -39,25 +69,48 @@ typedef enum tile_function
   WRITE_SINGLE = 2
 } tile_function_t;
 
-struct frame_data
+/* Lower number is polled first */
+typedef enum poll_priority
 {
-  uint8_t tile_number;
-  uint8_t function;
-  xgb_device_type_t device_type;
-  xgb_data_size_marking_t size_mark;
-  char address[6];
-};
+  POLL_PRIO_HIGH = 0,
+  POLL_PRIO_NORMAL = 1,
+  POLL_PRIO_LOW = 2,
+  POLL_NO_PRIORITIES = 3
+} poll_priority_t;
 
-typedef void (*tile_callback_t)(const struct frame_data *p_data);
+/*
+ * Setup of a tile, saved in flash as it is (12 B). Address is the number
+ * of its digits, enums are kept in bytes.
+ */
+typedef struct hmi_tile_config
+{
+  uint32_t address : 20;
+  uint32_t station_number : 5;
+  uint32_t function : 2; /* tile_function_t */
+  uint32_t priority : 2; /* poll_priority_t */
+  uint16_t poll_period_ms;
+  /* change of value smaller than deadband + percent of shown value is not
+   * drawn, 0 / 0 draws every change */
+  uint16_t deadband;
+  uint8_t device_type; /* xgb_device_type_t */
+  uint8_t size_mark;   /* xgb_data_size_marking_t */
+  uint8_t deadband_percent;
+} hmi_tile_config_t;
 
-typedef struct hmi_tile
+/*
+ * One array per field, index is the tile number. Loops of the poll
+ * scheduler touch only the arrays they need.
+ */
+typedef struct hmi_tile_table
 {
-  bool tile_active;
-  char *p_text;
-  struct frame_data data;
-  tile_callback_t callback;
-  int32_t value;
-} hmi_tile_t;
+  hmi_tile_config_t config[HMI_NO_TILES];
+  int32_t value[HMI_NO_TILES];
+  int32_t shown_value[HMI_NO_TILES];
+  int32_t setpoint[HMI_NO_TILES];
+  uint32_t next_poll_tick[HMI_NO_TILES];
+  uint32_t repaint_tick[HMI_NO_TILES];
+  uint8_t flags[HMI_NO_TILES];
+} hmi_tile_table_t;
 
 enum cursor_tiles
 {
@@ -67,10 +120,13 @@ enum cursor_tiles
   TILE_LEFT_ALLIGN_START = TILE_FUNCTION,
   TILE_DEVICE = 2,
   TILE_SIZE = 3,
-  TILE_STD_SWITCH_END = TILE_SIZE,
-  TILE_ADDRESS = 4,
-  TILE_LEFT_ALLIGN_END = TILE_ADDRESS,
-  TILE_EXIT = 5
+  TILE_POLL = 4,
+  TILE_DEADBAND = 5,
+  TILE_STD_SWITCH_END = TILE_DEADBAND,
+  TILE_ADDRESS = 6,
+  TILE_STATION = 7,
+  TILE_LEFT_ALLIGN_END = TILE_STATION,
+  TILE_EXIT = 8
 };
 
 typedef struct hmi_edit_cursors
@@ -79,10 +135,13 @@ typedef struct hmi_edit_cursors
   cursor horiz_fun;
   cursor horiz_dev;
   cursor horiz_size;
+  cursor horiz_poll;
+  cursor horiz_deadband;
   cursor horiz_address;
   cursor vert_address_num;
+  cursor horiz_station;
   cursor horiz_exit;
-  char address[6];
+  char address[HMI_ADDRESS_DIGITS + 1U];
   bool is_edit_mode_active;
 } hmi_edit_cursors_t;
 
@@ -95,10 +154,11 @@ typedef struct edit_option
 typedef struct hmi_screen
 {
   uint8_t active_main_tile;
-  hmi_tile_t tiles[10];
+  hmi_tile_table_t tiles;
 
 } hmi_main_screen_t;
 
 void hmi_main(void);
+hmi_boot_times_t hmi_get_boot_times(void);
 
 #endif /* INC_HMI_H_ */
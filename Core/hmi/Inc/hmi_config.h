@@ -0,0 +1,40 @@
+/*
+ * hmi_config.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: pawel
+ */
+
+#ifndef HMI_INC_HMI_CONFIG_H_
+#define HMI_INC_HMI_CONFIG_H_
+
+#include "stdbool.h"
+#include "stdint.h"
+
+#include "hmi.h"
+#include "xgb_comm.h"
+
+/* Last two 1 KB pages of the 32 KB flash, linker script keeps code out of
+ * them. Records are appended to one page, when it is full the newest ones
+ * are copied to the other page. */
+#define CFG_FLASH_PAGE_ADDR 0x08007800UL
+#define CFG_FLASH_PAGE_SIZE 0x400UL
+#define CFG_NO_PAGES 2U
+
+/* Records of other layout are ignored - raise it when a stored struct
+ * changes */
+#define CFG_FORMAT_VERSION 2U
+
+/* PLC link speed of each channel, found by commissioning */
+typedef struct hmi_link_config
+{
+  uint8_t baud_index[XGB_NO_CHANNELS];
+} hmi_link_config_t;
+
+void cfg_init(void);
+bool cfg_load_link(hmi_link_config_t *p_config);
+bool cfg_save_link(const hmi_link_config_t *p_config);
+bool cfg_load_tile(uint8_t tile_number, hmi_tile_config_t *p_config);
+bool cfg_save_tile(uint8_t tile_number, const hmi_tile_config_t *p_config);
+
+#endif /* HMI_INC_HMI_CONFIG_H_ */
@@ -16,7 +16,7 @@ void draw_small_tile(uint8_t tile_number, const char *text, bool center_text);
 void draw_wide_tile(const char *text, uint8_t tile_number, bool center_text,
                     ColorType color);
 void draw_main_menu_cursor(ColorType color, uint8_t active_tile);
-void draw_main_screen(uint8_t active_tile);
+bool draw_main_screen_band(uint8_t band, uint8_t active_tile);
 
 // edit menu draw
 void draw_edit_menu(uint8_t active_main_tile);
@@ -24,7 +24,8 @@ void draw_arrows_icon(ColorType color);
 void draw_address_char(const hmi_edit_cursors_t *p_cursors);
 void draw_exit_cursor(const hmi_edit_cursors_t *p_cursors, ColorType color);
 void draw_address_cursor(const hmi_edit_cursors_t *p_cursors, ColorType color);
-void draw_update_header_number(char new_number);
+void draw_station_switch(const hmi_edit_cursors_t *p_cursors);
+void draw_update_header_number(uint8_t tile_number);
 void draw_erase_std_switch_text(const hmi_edit_cursors_t *p_cursors,
                                 const edit_option_t **p_std_switch_array);
 void draw_std_switch_text(const hmi_edit_cursors_t *p_cursors,
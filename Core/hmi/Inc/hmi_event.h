@@ -0,0 +1,27 @@
+/*
+ * hmi_event.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: pawel
+ */
+
+#ifndef HMI_INC_HMI_EVENT_H_
+#define HMI_INC_HMI_EVENT_H_
+
+#include "stdint.h"
+
+/* Events are bits, several posts of the same event before the main loop
+ * wakes up are merged into one */
+#define EV_BUTTON 0x01UL
+#define EV_COMM 0x02UL
+#define EV_TIMER 0x04UL
+#define EV_RENDER 0x08UL
+/* Next step of a state that goes on without button or timer (start up) */
+#define EV_STEP 0x10UL
+
+void ev_post(uint32_t events);
+uint32_t ev_wait(void);
+void ev_wake_at(uint32_t tick);
+void ev_systick(void);
+
+#endif /* HMI_INC_HMI_EVENT_H_ */
@@ -10,14 +10,25 @@
 
 #define SWITCH_SCREEN 1U
 
-#define RETURN_FRAME_TIMEOUT 50U
-
 #define TIMEOUT_VAL (int32_t)0xFFFFFFFF
 #define NAK_VAL (int32_t)0xFFFFFFFD
 #define INITIAL_VAL (int32_t)0xFFFFFFFE
+#define STALE_VAL (int32_t)0xFFFFFFFC
+
+/* Tile is repainted at most this often, a value that drifted inside the
+ * deadband is repainted after HMI_FORCED_REPAINT_MS anyway */
+#define HMI_MIN_REPAINT_MS 250U
+#define HMI_FORCED_REPAINT_MS 5000U
+/* Analog values ignore this much noise by default (max 100) */
+#define HMI_DEADBAND_PERCENT_DEFAULT 1U
 
 void mm_write_initial_values_to_tiles(void);
+void mm_open_main_screen(void);
+void mm_restore_tiles(void);
+void mm_store_tile_value(uint8_t tile_number, int32_t new_value);
+void mm_set_default_deadband(hmi_tile_config_t *p_config);
 hmi_change_screen_t mm_active_screen(void);
-void mm_read_tile_function(const struct frame_data *frame_send);
+bool mm_render_tiles(uint32_t budget_ms);
+uint32_t mm_get_first_value_tick(void);
 
 #endif /* HMI_INC_HMI_MAIN_MENU_H_ */
@@ -0,0 +1,27 @@
+/*
+ * hmi_poll.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: pawel
+ */
+
+#ifndef HMI_INC_HMI_POLL_H_
+#define HMI_INC_HMI_POLL_H_
+
+#define POLL_PERIOD_HIGH_MS 100U
+#define POLL_PERIOD_NORMAL_MS 1000U
+#define POLL_PERIOD_LOW_MS 5000U
+/* Tiles of the pages that are not shown are polled at low priority and not
+ * more often than this */
+#define POLL_PERIOD_BACKGROUND_MS 5000U
+
+void poll_init_link(void);
+void poll_set_default_rate(hmi_tile_config_t *p_config);
+void poll_schedule_all_now(void);
+void poll_tile_changed(uint8_t tile_number);
+bool poll_is_station_allowed(uint8_t tile_number, uint8_t station_number);
+void poll_set_visible_page(uint8_t page);
+void poll_queue_write(uint8_t tile_number, int32_t value);
+void poll_process(void);
+
+#endif /* HMI_INC_HMI_POLL_H_ */
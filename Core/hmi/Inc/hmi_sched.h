@@ -0,0 +1,29 @@
+/*
+ * hmi_sched.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: pawel
+ */
+
+#ifndef HMI_INC_HMI_SCHED_H_
+#define HMI_INC_HMI_SCHED_H_
+
+#include "stdint.h"
+
+/*
+ * Run-to-completion task, started when one of its events is posted. Task
+ * that has work left after its budget posts its own event again.
+ */
+typedef struct sched_task
+{
+  void (*run)(void);
+  uint32_t events;
+  uint16_t budget_ms;
+  /* profiling - longest run and number of runs over budget */
+  uint16_t worst_ms;
+  uint16_t overruns;
+} sched_task_t;
+
+void sched_run(sched_task_t *p_tasks, uint8_t no_tasks);
+
+#endif /* HMI_INC_HMI_SCHED_H_ */
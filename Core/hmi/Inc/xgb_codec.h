@@ -0,0 +1,32 @@
+/*
+ * xgb_codec.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: pawel
+ */
+
+#ifndef HMI_INC_XGB_CODEC_H_
+#define HMI_INC_XGB_CODEC_H_
+
+#include "stdbool.h"
+#include "stdint.h"
+
+/* Every number in Cnet frame is sent as ASCII hex, MSB first. Encoders
+ * return pointer behind the written characters, decoders return false if
+ * field contains character that is not hex digit. */
+
+uint8_t *xgb_codec_put_byte(uint8_t *p_dest, uint8_t value);
+uint8_t *xgb_codec_put_word(uint8_t *p_dest, uint16_t value);
+uint8_t *xgb_codec_put_dword(uint8_t *p_dest, uint32_t value);
+uint8_t *xgb_codec_put_lword(uint8_t *p_dest, uint64_t value);
+uint8_t *xgb_codec_put_value(uint8_t *p_dest, uint32_t value,
+                             uint8_t no_bytes);
+
+bool xgb_codec_get_byte(const uint8_t *p_src, uint8_t *p_value);
+bool xgb_codec_get_word(const uint8_t *p_src, uint16_t *p_value);
+bool xgb_codec_get_dword(const uint8_t *p_src, uint32_t *p_value);
+bool xgb_codec_get_lword(const uint8_t *p_src, uint64_t *p_value);
+bool xgb_codec_get_value(const uint8_t *p_src, uint8_t no_bytes,
+                         uint32_t *p_value);
+
+#endif /* HMI_INC_XGB_CODEC_H_ */
@@ -9,12 +9,39 @@
 #define INC_XGB_COMM_H_
 
 #include "assert.h"
+#include "stdbool.h"
 #include "stdint.h"
 
 #define MAX_FRAME_SIZE 256
 #define MAX_DATA_SIZE 16
 
-#define STATION_NUMBER 1
+/* Cnet limit of blocks in one individual read / write frame */
+#define XGB_MAX_BLOCKS 16U
+/* Monitor registers available in PLC: 00 - 1F */
+#define XGB_MAX_MONITOR_REGISTER 0x1FU
+
+/* Station of new tiles, Cnet station numbers are 00 - 1F */
+#define XGB_DEFAULT_STATION 1U
+#define XGB_MAX_STATION_NUMBER 0x1FU
+
+/* Idle time on RS-485 bus between the end of response and the next request,
+ * so the station that answered has released the line */
+#define XGB_BUS_TURNAROUND_MS 2U
+
+/* PLC channels: USART1 and USART2, each with own RS-485 bus. Stations are
+ * split between buses by the bit masks (bit n = station n) */
+#define XGB_NO_CHANNELS 2U
+#define XGB_CHANNEL1_STATIONS 0x0000FFFFUL
+#define XGB_CHANNEL2_STATIONS 0xFFFF0000UL
+
+/* Link speeds 9600 - 115200 bps by index, commissioning picks the fastest
+ * one that works and the panel keeps it in config */
+#define XGB_NO_BAUD_RATES 5U
+#define XGB_BAUD_DEFAULT 4U
+
+/* ACK|station|command|command type|ETX|BCC - response to write and monitor
+ * register */
+#define XGB_ACK_RESPONSE_LENGHT 9U
 
 /*
  * FRAME FORMAT:
@@ -30,6 +57,10 @@
  * NAK response frame (XGB?external communication device when receiving data
  * abnormally): Header(NAK)|Station number|Command|Command type|Error code
  * (ASCII 4 Byte)|Tail(ETX)|Frame check(BCC)
+ *
+ * Frame check is optional, it is used with stations that have it enabled
+ * (xgb_station_set_bcc). Command letter is sent in lower case then and BCC
+ * is the lower byte of the sum of all bytes from header to tail, as hex.
  */
 
 /*
@@ -72,65 +103,23 @@ typedef enum xgb_device_type {
 typedef enum xgb_comm_error {
   XGB_OK = 0,
   XGB_ERR_TRANSMIT_TIMEOUT = -1,
-  XGB_ERR_EOT_MISSING = -2
+  XGB_ERR_EOT_MISSING = -2,
+  XGB_ERR_NAK = -3,
+  XGB_ERR_FRAME = -4,
+  XGB_ERR_NO_FRAME = -5,
+  XGB_ERR_BCC = -6
 
 }xgb_comm_err_t;
 
 /*
- * Parameters required for individual read command frame
- */
-struct data_ind_read_frame {
-  uint8_t station_number;
-  uint8_t no_of_blocks;
-  xgb_data_size_marking_t data_size;
-  xgb_device_type_t device_type;
-  const char *p_device_address;
-};
-
-/*
- * Parameters required for individual write command frame
- */
-struct data_ind_write_frame {
-  uint8_t station_number;
-  uint8_t no_of_blocks;
-  xgb_data_size_marking_t data_size;
-  xgb_device_type_t device_type;
-  const char *p_device_address;
-  uint8_t *p_data_buffer;
-};
-
-/*
- * Parameters required for continuous read command frame
+ * Single device of a multi block request, e.g. %MW100
  */
-struct data_cont_read_frame {
-  uint8_t station_number;
-  xgb_data_size_marking_t data_size;
+typedef struct xgb_device
+{
   xgb_device_type_t device_type;
-  uint8_t no_of_data;
-  const char *p_device_address;
-};
-
-/*
- * Parameters required for continuous write command frame
- */
-struct data_cont_write_frame {
-  uint8_t station_number;
-  xgb_data_size_marking_t data_size;
-  xgb_device_type_t device_type;
-  uint8_t no_of_data;
-  const char *p_device_address;
-  uint8_t *p_data_buffer;
-};
-
-/*
- * To not miss any parameters during command send, structs are created
- */
-typedef union cmd_frame_data {
-  struct data_ind_read_frame ind_read;
-  struct data_ind_write_frame ind_write;
-  struct data_cont_read_frame cont_read;
-  struct data_cont_write_frame cont_write;
-} cmd_frame_data;
+  xgb_data_size_marking_t size_mark;
+  const char *p_address;
+} xgb_device_t;
 
 typedef uint8_t station_number_t[2];
 typedef uint8_t command_t;
@@ -231,9 +220,59 @@ typedef union frame {
   struct cmd_cont_write_frame cont_write_frame;
 } u_frame;
 
+typedef struct xgb_channel xgb_channel_t;
+
+xgb_comm_err_t xgb_read_devices(xgb_channel_t *p_channel,
+                                uint8_t station_number,
+                                const xgb_device_t *p_devices,
+                                uint8_t no_of_devices);
+xgb_comm_err_t xgb_write_devices(xgb_channel_t *p_channel,
+                                 uint8_t station_number,
+                                 const xgb_device_t *p_devices,
+                                 const int32_t *p_values,
+                                 uint8_t no_of_devices);
+xgb_comm_err_t xgb_write_continuous(xgb_channel_t *p_channel,
+                                    uint8_t station_number,
+                                    const xgb_device_t *p_first_device,
+                                    const int32_t *p_values,
+                                    uint8_t no_of_data);
+xgb_comm_err_t xgb_register_monitor(xgb_channel_t *p_channel,
+                                    uint8_t station_number,
+                                    uint8_t register_number,
+                                    const xgb_device_t *p_devices,
+                                    uint8_t no_of_devices);
+xgb_comm_err_t xgb_execute_monitor(xgb_channel_t *p_channel,
+                                   uint8_t station_number,
+                                   uint8_t register_number);
+bool xgb_read_fits(const xgb_device_t *p_devices, uint8_t no_of_devices);
+bool xgb_write_fits(const xgb_device_t *p_devices, uint8_t no_of_devices);
+bool xgb_write_continuous_fits(const xgb_device_t *p_first_device,
+                               uint8_t no_of_data);
+uint16_t xgb_read_response_lenght(const xgb_device_t *p_devices,
+                                  uint8_t no_of_devices);
+xgb_comm_err_t xgb_parse_read_response(const u_frame *p_frame,
+                                       int32_t *p_values,
+                                       uint8_t no_of_devices);
+xgb_comm_err_t xgb_parse_ack_response(const u_frame *p_frame);
 
-xgb_comm_err_t xgb_read_single_device(const xgb_device_type_t type,
-                                      const xgb_data_size_marking_t size_mark,
-                                      const char *address);
+xgb_channel_t *xgb_channel_for_station(uint8_t station_number);
+xgb_channel_t *xgb_get_channel(uint8_t channel_index);
+void xgb_channel_set_baud(xgb_channel_t *p_channel, uint8_t baud_index);
+uint8_t xgb_channel_get_baud(const xgb_channel_t *p_channel);
+uint32_t xgb_channel_wire_time(const xgb_channel_t *p_channel,
+                               uint16_t no_bytes);
+void xgb_start_receiving(void);
+void xgb_flush_received(xgb_channel_t *p_channel);
+void xgb_channel_service(xgb_channel_t *p_channel);
+void xgb_tick(void);
+bool xgb_channel_is_sending(const xgb_channel_t *p_channel);
+bool xgb_channel_is_armed(const xgb_channel_t *p_channel);
+uint32_t xgb_channel_sent_tick(const xgb_channel_t *p_channel);
+uint32_t xgb_channel_received_tick(const xgb_channel_t *p_channel);
+uint32_t xgb_channel_response_time(const xgb_channel_t *p_channel);
+void xgb_channel_response_timeout(xgb_channel_t *p_channel);
+void xgb_channel_cancel(xgb_channel_t *p_channel);
+xgb_comm_err_t xgb_get_response_frame(xgb_channel_t *p_channel,
+                                      const u_frame **pp_frame);
 
 #endif /* INC_XGB_COMM_H_ */
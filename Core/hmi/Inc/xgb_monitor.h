@@ -0,0 +1,36 @@
+/*
+ * xgb_monitor.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: pawel
+ */
+
+#ifndef HMI_INC_XGB_MONITOR_H_
+#define HMI_INC_XGB_MONITOR_H_
+
+#include "xgb_comm.h"
+
+/* Fixed groups of devices with a PLC monitor register, each station has
+ * registers 00 - 1F. Groups over the limit are read with plain RSS. */
+#define XGB_MONITOR_SLOTS 32U
+/* group has no monitor register */
+#define XGB_MONITOR_NONE 0xFFU
+/* Failed executes of registered monitor in a row before it is given up */
+#define XGB_MONITOR_MAX_FAILURES 2U
+
+typedef enum xgb_monitor_state
+{
+  XGB_MONITOR_FREE = 0,
+  XGB_MONITOR_UNREGISTERED = 1,
+  XGB_MONITOR_REGISTERED = 2,
+  XGB_MONITOR_REJECTED = 3
+} xgb_monitor_state_t;
+
+void xgb_monitor_reset(void);
+uint8_t xgb_monitor_add(uint8_t station_number);
+xgb_monitor_state_t xgb_monitor_get(uint8_t slot, uint8_t *p_register_number);
+void xgb_monitor_registered(uint8_t slot, bool accepted);
+void xgb_monitor_executed(uint8_t slot, bool accepted);
+void xgb_monitor_invalidate_station(uint8_t station_number);
+
+#endif /* HMI_INC_XGB_MONITOR_H_ */
@@ -0,0 +1,59 @@
+/*
+ * xgb_station.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: pawel
+ */
+
+#ifndef HMI_INC_XGB_STATION_H_
+#define HMI_INC_XGB_STATION_H_
+
+#include "stdbool.h"
+#include "stdint.h"
+
+/* Number of different PLC stations the panel keeps statistics for, tiles
+ * take no more stations than that (poll_is_station_allowed) */
+#define XGB_MAX_STATIONS 4U
+
+/* Response timeout limits, initial value is used until first response.
+ * Initial value and floor are added to the time of the expected response on
+ * the wire, so a long response at low speed always fits. */
+#define XGB_RTO_INITIAL_MS 50U
+#define XGB_RTO_MIN_MS 10U
+#define XGB_RTO_MAX_MS 500U
+
+/* Consecutive timeouts after which station is treated as dead. Dead station
+ * is only probed with single request, probe period doubles up to max */
+#define XGB_STATION_FAIL_LIMIT 3U
+#define XGB_PROBE_BACKOFF_MIN_MS 250U
+#define XGB_PROBE_BACKOFF_MAX_MS 8000U
+
+/* Frame check (BCC) is used with stations that are not configured otherwise */
+#define XGB_STATION_BCC_DEFAULT false
+
+/* Responses with data (read, monitor execute) and without data (write,
+ * monitor register) */
+typedef enum xgb_frame_type
+{
+  XGB_FRAME_READ = 0,
+  XGB_FRAME_WRITE = 1,
+  XGB_NO_FRAME_TYPES = 2
+} xgb_frame_type_t;
+
+uint32_t xgb_station_get_timeout(uint8_t station_number,
+                                 xgb_frame_type_t frame_type,
+                                 uint32_t reply_ms);
+void xgb_station_rtt_sample(uint8_t station_number, xgb_frame_type_t frame_type,
+                            uint32_t rtt_ms);
+void xgb_station_timeout(uint8_t station_number, xgb_frame_type_t frame_type);
+
+bool xgb_station_is_online(uint8_t station_number);
+bool xgb_station_is_probe_due(uint8_t station_number, uint32_t now);
+uint32_t xgb_station_get_probe_tick(uint8_t station_number);
+
+void xgb_station_release_unused(uint32_t station_mask);
+
+void xgb_station_set_bcc(uint8_t station_number, bool enabled);
+bool xgb_station_is_bcc_enabled(uint8_t station_number);
+
+#endif /* HMI_INC_XGB_STATION_H_ */
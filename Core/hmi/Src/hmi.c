@@ -7,92 +7,269 @@
 
 #include "main.h"
 
+#include "5buttons.h"
 #include "fonts.h"
 
 #include "hmi.h"
+#include "hmi_config.h"
 #include "hmi_draw.h"
 #include "hmi_edit_menu.h"
+#include "hmi_event.h"
 #include "hmi_main_menu.h"
 #include "hmi_mock.h"
+#include "hmi_poll.h"
+#include "hmi_sched.h"
+
+/* Render gives the CPU back after this, button is handled in between */
+#define HMI_RENDER_BUDGET_MS 20U
+#define HMI_INPUT_BUDGET_MS 50U
+#define HMI_COMM_BUDGET_MS 2U
+#define HMI_NO_TASKS 3U
 
 extern SPI_HandleTypeDef hspi1;
 static volatile hmi_state_t hmi_state;
+/* polling starts once the tiles are loaded, before the display is up */
+static bool comm_running;
+static hmi_boot_times_t boot_times;
+static uint8_t first_frame_band;
 
+static void input_task(void);
+static void comm_task(void);
+static void render_task(void);
+static void run_state(void);
 static void change_state(hmi_state_t state);
+static bool is_booting(void);
 
 static void init_read_eeprom(void);
 static void init_tft(void);
+static void draw_first_frame(void);
+static void tft_display_on(void);
 static void init_main_menu(void);
 static void main_menu_active(void);
 static void init_edit_menu(void);
 static void edit_menu_active(void);
 
+/* Lower index runs first after a wake up. Input task runs the screen states,
+ * start up steps wake it with EV_STEP or the timer. Timer wakes the render
+ * task for tiles whose repaint was held back. */
+static sched_task_t hmi_tasks[HMI_NO_TASKS] = {
+    {.run = input_task,
+     .events = EV_BUTTON | EV_TIMER | EV_STEP,
+     .budget_ms = HMI_INPUT_BUDGET_MS},
+    {.run = comm_task,
+     .events = EV_COMM | EV_TIMER,
+     .budget_ms = HMI_COMM_BUDGET_MS},
+    {.run = render_task,
+     .events = EV_RENDER | EV_TIMER,
+     .budget_ms = HMI_RENDER_BUDGET_MS}};
+
 void hmi_main(void)
 {
   hmi_state = READ_EEPROM;
+  xgb_start_receiving();
+
+  // input task runs the start up states
+  ev_post(EV_STEP);
+
   while (1)
     {
-      switch (hmi_state)
-        {
-        case (READ_EEPROM):
-          {
-            init_read_eeprom();
-            break;
-          }
-
-        case (INIT_TFT):
-          {
-            init_tft();
-            break;
-          }
-
-        case (INIT_MAIN_MENU):
-          {
-            init_main_menu();
-            break;
-          }
-
-        case (MAIN_MENU):
-          {
-            main_menu_active();
-            break;
-          }
-
-        case (INIT_EDIT_MENU):
-          {
-            init_edit_menu();
-            break;
-          }
-
-        case (EDIT_MENU):
-          {
-            edit_menu_active();
-            break;
-          }
-
-        default:
-          {
-          }
-        }
+      sched_run(hmi_tasks, HMI_NO_TASKS);
+    }
+
+  return;
+}
+
+/*
+ * Screen state machine - init states run in the same step as the state
+ * they lead to, so new tile config is rescheduled before the comm task
+ * runs again
+ */
+static void input_task(void)
+{
+  hmi_state_t last_state;
+
+  do
+    {
+      last_state = hmi_state;
+      run_state();
+    }
+  while (last_state != hmi_state);
+
+  // one button per step, the rest in the next one - buttons pressed during
+  // the start up wait for the main screen
+  if (false == is_booting() && IDLE != buttons_get_pending_flag())
+    {
+      ev_post(EV_BUTTON);
+    }
+
+  return;
+}
+
+/*
+ * Polling goes on under the edit menu too, values wait for the render task
+ */
+static void comm_task(void)
+{
+  if (true == comm_running)
+    {
+      poll_process();
+    }
+
+  return;
+}
+
+/*
+ * Only the main screen shows tile values, a page that is opened gets its
+ * frame drawn here too. First frame gets its values before the display is
+ * on.
+ */
+static void render_task(void)
+{
+  if ((MAIN_MENU == hmi_state || TFT_DISPLAY_ON == hmi_state) &&
+      true == mm_render_tiles(HMI_RENDER_BUDGET_MS))
+    {
+      ev_post(EV_RENDER);
     }
 
   return;
 }
 
-static void init_read_eeprom(void) { hmi_state = INIT_TFT; }
+static void run_state(void)
+{
+  switch (hmi_state)
+    {
+    case (READ_EEPROM):
+      {
+        init_read_eeprom();
+        break;
+      }
+
+    case (INIT_TFT):
+      {
+        init_tft();
+        break;
+      }
+
+    case (DRAW_FIRST_FRAME):
+      {
+        draw_first_frame();
+        break;
+      }
+
+    case (TFT_DISPLAY_ON):
+      {
+        tft_display_on();
+        break;
+      }
+
+    case (INIT_MAIN_MENU):
+      {
+        init_main_menu();
+        break;
+      }
+
+    case (MAIN_MENU):
+      {
+        main_menu_active();
+        break;
+      }
+
+    case (INIT_EDIT_MENU):
+      {
+        init_edit_menu();
+        break;
+      }
+
+    case (EDIT_MENU):
+      {
+        edit_menu_active();
+        break;
+      }
+
+    default:
+      {
+      }
+    }
 
+  return;
+}
+
+/*
+ * Display reset runs while tiles and link speed are loaded from flash. PLC
+ * is polled right away, first values come during the display start up.
+ */
+static void init_read_eeprom(void)
+{
+  ILI9341_InitStart(&hspi1);
+  cfg_init();
+  mm_restore_tiles();
+  poll_init_link();
+  mm_write_initial_values_to_tiles();
+  comm_running = true;
+  boot_times.comm_start_tick = HAL_GetTick();
+  // tiles are due now, first poll does not wait for the timer
+  ev_post(EV_TIMER);
+  change_state(INIT_TFT);
+  return;
+}
+
+/*
+ * Controller waits are timer wake ups - comm task runs in between
+ */
 static void init_tft(void)
 {
-  ILI9341_Init(&hspi1);
+  if (ILI9341_INIT_BUSY == ILI9341_InitStep())
+    {
+      ev_wake_at(ILI9341_InitWakeTick());
+      return;
+    }
+
+  boot_times.gram_ready_tick = HAL_GetTick();
   GFX_SetFont(font_8x5);
-  change_state(INIT_MAIN_MENU);
+  first_frame_band = 0;
+  change_state(DRAW_FIRST_FRAME);
   return;
 }
 
+/*
+ * One band per step, polling goes on between them. Display is still off and
+ * shows the whole frame at once.
+ */
+static void draw_first_frame(void)
+{
+  if (false == draw_main_screen_band(first_frame_band++, 0))
+    {
+      ev_post(EV_STEP);
+      return;
+    }
+
+  boot_times.first_frame_tick = HAL_GetTick();
+  // values received during the start up
+  ev_post(EV_RENDER);
+  change_state(TFT_DISPLAY_ON);
+  return;
+}
+
+static void tft_display_on(void)
+{
+  if (ILI9341_INIT_DONE != ILI9341_InitStep())
+    {
+      ev_wake_at(ILI9341_InitWakeTick());
+      return;
+    }
+
+  boot_times.display_on_tick = HAL_GetTick();
+  change_state(MAIN_MENU);
+  return;
+}
+
+/*
+ * Tiles keep their values and requests in flight, only the tile saved in
+ * the edit menu starts over
+ */
 static void init_main_menu(void)
 {
-  mm_write_initial_values_to_tiles();
-  draw_main_screen(0);
+  mm_open_main_screen();
   change_state(MAIN_MENU);
   return;
 }
@@ -128,3 +305,21 @@ static void change_state(hmi_state_t state)
   hmi_state = state;
   return;
 }
+
+static bool is_booting(void)
+{
+  return (READ_EEPROM == hmi_state || INIT_TFT == hmi_state ||
+          DRAW_FIRST_FRAME == hmi_state || TFT_DISPLAY_ON == hmi_state);
+}
+
+/*
+ * Power on to live values, read with the debugger
+ */
+hmi_boot_times_t hmi_get_boot_times(void)
+{
+  hmi_boot_times_t times = boot_times;
+
+  times.first_value_tick = mm_get_first_value_tick();
+
+  return times;
+}
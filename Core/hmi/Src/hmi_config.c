@@ -0,0 +1,414 @@
+/*
+ * hmi_config.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: pawel
+ */
+
+#include "assert.h"
+#include "main.h"
+#include "stddef.h"
+#include "string.h"
+
+#include "hmi_config.h"
+
+/* 'CFGP' - erased flash (0xFF) or other data is never taken as a page */
+#define CFG_PAGE_MAGIC 0x43464750UL
+#define NO_PAGE 0xFFU
+#define NO_RECORD 0xFFFFU
+#define ERASED_KEY 0xFFU
+#define CFG_MAX_PAYLOAD 16U
+
+/*
+ * One key per stored item, the newest record of a key is valid
+ */
+typedef enum cfg_key
+{
+  CFG_KEY_LINK = 0,
+  CFG_KEY_TILE_FIRST = 1,
+  CFG_NO_KEYS = CFG_KEY_TILE_FIRST + HMI_NO_TILES
+} cfg_key_t;
+
+/*
+ * Sequence is written before magic - page with magic is complete. Higher
+ * sequence is the newer page.
+ */
+typedef struct cfg_page_header
+{
+  uint32_t magic;
+  uint32_t sequence;
+} cfg_page_header_t;
+
+/*
+ * Record: header, payload padded to words, CRC-32 of both (hardware CRC
+ * unit). Header goes first, so torn write is a record with a wrong CRC.
+ */
+typedef struct cfg_record_header
+{
+  uint8_t key;
+  uint8_t version;
+  uint16_t lenght;
+} cfg_record_header_t;
+
+static_assert(sizeof(hmi_link_config_t) <= CFG_MAX_PAYLOAD,
+              "Link config does not fit record");
+static_assert(sizeof(hmi_tile_config_t) <= CFG_MAX_PAYLOAD,
+              "Tile config does not fit record");
+static_assert(CFG_NO_KEYS * (sizeof(cfg_record_header_t) + CFG_MAX_PAYLOAD +
+                             sizeof(uint32_t)) <=
+                  CFG_FLASH_PAGE_SIZE - sizeof(cfg_page_header_t),
+              "Newest records do not fit one page");
+
+/* Built once at boot, loads do not scan the flash */
+static uint16_t record_offset[CFG_NO_KEYS];
+static uint8_t active_page = NO_PAGE;
+static uint16_t free_offset;
+static uint32_t page_sequence;
+
+static bool load_record(cfg_key_t key, void *p_payload, uint16_t lenght);
+static bool save_record(cfg_key_t key, const void *p_payload, uint16_t lenght);
+static void scan_page(void);
+static uint16_t get_record_size(const cfg_record_header_t *p_header);
+static bool is_record_valid(const cfg_record_header_t *p_header);
+static bool swap_pages(void);
+static bool program_words(uint32_t address, const uint32_t *p_words,
+                          uint32_t no_bytes);
+static uint32_t calculate_crc(const uint32_t *p_words, uint32_t no_words);
+static uint32_t get_page_address(uint8_t page);
+static const cfg_page_header_t *get_page_header(uint8_t page);
+static bool is_page_valid(uint8_t page);
+
+/*
+ * Newest valid page is found and its records indexed by key, so every load
+ * after that is a table lookup
+ */
+void cfg_init(void)
+{
+  __HAL_RCC_CRC_CLK_ENABLE();
+
+  active_page = NO_PAGE;
+
+  for (uint8_t page = 0; page < CFG_NO_PAGES; page++)
+    {
+      if (true == is_page_valid(page) &&
+          (NO_PAGE == active_page ||
+           (int32_t)(get_page_header(page)->sequence - page_sequence) > 0))
+        {
+          active_page = page;
+          page_sequence = get_page_header(page)->sequence;
+        }
+    }
+
+  scan_page();
+
+  return;
+}
+
+/*
+ * Returns false if no valid config was saved (new panel, power lost during
+ * the first save) - caller keeps its defaults then
+ */
+bool cfg_load_link(hmi_link_config_t *p_config)
+{
+  return load_record(CFG_KEY_LINK, p_config, sizeof(hmi_link_config_t));
+}
+
+bool cfg_save_link(const hmi_link_config_t *p_config)
+{
+  return save_record(CFG_KEY_LINK, p_config, sizeof(hmi_link_config_t));
+}
+
+bool cfg_load_tile(uint8_t tile_number, hmi_tile_config_t *p_config)
+{
+  if (tile_number >= HMI_NO_TILES)
+    {
+      return false;
+    }
+
+  return load_record((cfg_key_t)(CFG_KEY_TILE_FIRST + tile_number), p_config,
+                     sizeof(hmi_tile_config_t));
+}
+
+bool cfg_save_tile(uint8_t tile_number, const hmi_tile_config_t *p_config)
+{
+  if (tile_number >= HMI_NO_TILES)
+    {
+      return false;
+    }
+
+  return save_record((cfg_key_t)(CFG_KEY_TILE_FIRST + tile_number), p_config,
+                     sizeof(hmi_tile_config_t));
+}
+
+static bool load_record(cfg_key_t key, void *p_payload, uint16_t lenght)
+{
+  const cfg_record_header_t *p_header;
+
+  if (NO_RECORD == record_offset[key])
+    {
+      return false;
+    }
+
+  p_header = (const cfg_record_header_t *)(get_page_address(active_page) +
+                                           record_offset[key]);
+
+  if (lenght != p_header->lenght)
+    {
+      return false;
+    }
+
+  memcpy(p_payload, p_header + 1, lenght);
+
+  return true;
+}
+
+/*
+ * Record is appended only when the data really changed. Full page is
+ * swapped first - erase stops the CPU for ~20 ms.
+ */
+static bool save_record(cfg_key_t key, const void *p_payload, uint16_t lenght)
+{
+  uint32_t record[(sizeof(cfg_record_header_t) + CFG_MAX_PAYLOAD +
+                   sizeof(uint32_t)) /
+                  sizeof(uint32_t)];
+  cfg_record_header_t *p_header = (cfg_record_header_t *)record;
+  uint16_t record_size;
+  uint16_t no_words;
+
+  if (lenght > CFG_MAX_PAYLOAD)
+    {
+      return false;
+    }
+
+  // padding is covered by CRC too
+  memset(record, 0, sizeof(record));
+  p_header->key = (uint8_t)key;
+  p_header->version = CFG_FORMAT_VERSION;
+  p_header->lenght = lenght;
+  memcpy(p_header + 1, p_payload, lenght);
+
+  record_size = get_record_size(p_header);
+  no_words = (record_size / sizeof(uint32_t)) - 1U;
+  record[no_words] = calculate_crc(record, no_words);
+
+  if (NO_RECORD != record_offset[key] &&
+      0 == memcmp((const void *)(get_page_address(active_page) +
+                                 record_offset[key]),
+                  record, record_size))
+    {
+      return true;
+    }
+
+  if ((NO_PAGE == active_page ||
+       free_offset + record_size > CFG_FLASH_PAGE_SIZE) &&
+      false == swap_pages())
+    {
+      return false;
+    }
+
+  if (false == program_words(get_page_address(active_page) + free_offset,
+                             record, record_size))
+    {
+      // written part is skipped as a record with a wrong CRC
+      free_offset = CFG_FLASH_PAGE_SIZE;
+      return false;
+    }
+
+  record_offset[key] = free_offset;
+  free_offset += record_size;
+
+  return true;
+}
+
+/*
+ * Later record of a key replaces the earlier one. Header that does not
+ * fit the page (torn write) ends the scan and the page is taken as full.
+ */
+static void scan_page(void)
+{
+  uint32_t page_address;
+  uint16_t offset = sizeof(cfg_page_header_t);
+
+  for (uint8_t i = 0; i < CFG_NO_KEYS; i++)
+    {
+      record_offset[i] = NO_RECORD;
+    }
+
+  free_offset = CFG_FLASH_PAGE_SIZE;
+
+  if (NO_PAGE == active_page)
+    {
+      return;
+    }
+
+  page_address = get_page_address(active_page);
+
+  while (offset + sizeof(cfg_record_header_t) <= CFG_FLASH_PAGE_SIZE)
+    {
+      const cfg_record_header_t *p_header =
+          (const cfg_record_header_t *)(page_address + offset);
+      uint16_t record_size;
+
+      if (ERASED_KEY == p_header->key)
+        {
+          free_offset = offset;
+          break;
+        }
+
+      record_size = get_record_size(p_header);
+
+      if (p_header->lenght > CFG_MAX_PAYLOAD ||
+          offset + record_size > CFG_FLASH_PAGE_SIZE)
+        {
+          break;
+        }
+
+      if (true == is_record_valid(p_header))
+        {
+          record_offset[p_header->key] = offset;
+        }
+
+      offset += record_size;
+    }
+
+  return;
+}
+
+static uint16_t get_record_size(const cfg_record_header_t *p_header)
+{
+  uint16_t padded_lenght =
+      (p_header->lenght + sizeof(uint32_t) - 1U) & ~(sizeof(uint32_t) - 1U);
+
+  return sizeof(cfg_record_header_t) + padded_lenght + sizeof(uint32_t);
+}
+
+static bool is_record_valid(const cfg_record_header_t *p_header)
+{
+  const uint32_t *p_words = (const uint32_t *)p_header;
+  uint16_t no_words = (get_record_size(p_header) / sizeof(uint32_t)) - 1U;
+
+  return (CFG_FORMAT_VERSION == p_header->version &&
+          p_header->key < CFG_NO_KEYS &&
+          calculate_crc(p_words, no_words) == p_words[no_words]);
+}
+
+/*
+ * Newest record of every key is copied to the erased spare page, its
+ * header goes last. Power lost before that leaves the old page active.
+ */
+static bool swap_pages(void)
+{
+  uint8_t new_page = (NO_PAGE == active_page) ? 0U : (active_page ^ 1U);
+  uint32_t new_address = get_page_address(new_page);
+  uint16_t new_offset = sizeof(cfg_page_header_t);
+  uint16_t new_record_offset[CFG_NO_KEYS];
+  cfg_page_header_t header = {.magic = CFG_PAGE_MAGIC,
+                              .sequence = page_sequence + 1U};
+  FLASH_EraseInitTypeDef erase = {.TypeErase = FLASH_TYPEERASE_PAGES,
+                                  .PageAddress = new_address,
+                                  .NbPages = 1};
+  uint32_t page_error = 0;
+  HAL_StatusTypeDef status;
+
+  HAL_FLASH_Unlock();
+  status = HAL_FLASHEx_Erase(&erase, &page_error);
+  HAL_FLASH_Lock();
+
+  if (HAL_OK != status)
+    {
+      return false;
+    }
+
+  for (uint8_t i = 0; i < CFG_NO_KEYS; i++)
+    {
+      const cfg_record_header_t *p_header;
+      uint16_t record_size;
+
+      new_record_offset[i] = NO_RECORD;
+
+      if (NO_RECORD == record_offset[i])
+        {
+          continue;
+        }
+
+      p_header = (const cfg_record_header_t *)(get_page_address(active_page) +
+                                               record_offset[i]);
+      record_size = get_record_size(p_header);
+
+      if (false == program_words(new_address + new_offset,
+                                 (const uint32_t *)p_header, record_size))
+        {
+          return false;
+        }
+
+      new_record_offset[i] = new_offset;
+      new_offset += record_size;
+    }
+
+  if (false == program_words(new_address + offsetof(cfg_page_header_t,
+                                                    sequence),
+                             &header.sequence, sizeof(header.sequence)) ||
+      false == program_words(new_address, &header.magic, sizeof(header.magic)))
+    {
+      return false;
+    }
+
+  memcpy(record_offset, new_record_offset, sizeof(record_offset));
+  active_page = new_page;
+  page_sequence = header.sequence;
+  free_offset = new_offset;
+
+  return true;
+}
+
+/*
+ * Flash is programmed in half words
+ */
+static bool program_words(uint32_t address, const uint32_t *p_words,
+                          uint32_t no_bytes)
+{
+  const uint16_t *p_half_words = (const uint16_t *)p_words;
+  HAL_StatusTypeDef status = HAL_OK;
+
+  HAL_FLASH_Unlock();
+
+  for (uint32_t i = 0; HAL_OK == status && i < no_bytes / 2U; i++)
+    {
+      status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, address + (2U * i),
+                                 p_half_words[i]);
+    }
+
+  HAL_FLASH_Lock();
+
+  return (HAL_OK == status);
+}
+
+/*
+ * CRC unit of the F1 takes whole words (CRC-32, polynomial 0x04C11DB7)
+ */
+static uint32_t calculate_crc(const uint32_t *p_words, uint32_t no_words)
+{
+  CRC->CR = CRC_CR_RESET;
+
+  for (uint32_t i = 0; i < no_words; i++)
+    {
+      CRC->DR = p_words[i];
+    }
+
+  return CRC->DR;
+}
+
+static uint32_t get_page_address(uint8_t page)
+{
+  return CFG_FLASH_PAGE_ADDR + (page * CFG_FLASH_PAGE_SIZE);
+}
+
+static const cfg_page_header_t *get_page_header(uint8_t page)
+{
+  return (const cfg_page_header_t *)get_page_address(page);
+}
+
+static bool is_page_valid(uint8_t page)
+{
+  return (CFG_PAGE_MAGIC == get_page_header(page)->magic);
+}
@@ -13,7 +13,7 @@
 #include "hmi_draw.h"
 
 #define WIDE_TILE_WIDTH 314U
-#define WIDE_TILE_HEIGHT 27U
+#define WIDE_TILE_HEIGHT 23U
 
 #define SMALL_TILE_WIDTH 155U
 #define SMALL_TILE_HEIGHT 40U
@@ -37,7 +37,7 @@
 #define FONT_SPACE 1U
 #define FONT_HEIGHT 8U
 #define TEXT_X_OFFSET_WIDE_TILE 10U
-#define TEXT_Y_OFFSET_WIDE_TILE 10U
+#define TEXT_Y_OFFSET_WIDE_TILE 8U
 #define TEXT_X_OFFSET_SMALL_TILE 18U
 
 #define STD_SW_LEFT_LIMIT 150
@@ -47,11 +47,13 @@ static uint32_t find_x_to_center_text(const char *text, uint32_t left_limit,
                                       uint32_t right_limit);
 static uint32_t get_switch_cursor_val(const hmi_edit_cursors_t *p_cursors);
 static void draw_initial_address_switch(void);
+static uint8_t get_tile_column(uint8_t tile_number);
+static uint8_t get_tile_row(uint8_t tile_number);
 
 void draw_small_tile(uint8_t tile_number, const char *text, bool center_text)
 {
-  uint8_t column = tile_number / 5;
-  uint8_t row = tile_number % 5;
+  uint8_t column = get_tile_column(tile_number);
+  uint8_t row = get_tile_row(tile_number);
 
   uint32_t x_pos = (column * OFFSET_X_SECOND_COLUMN) + OFFSET_X_LEFT_BORDER;
   uint32_t y_pos = (row * DISTANCE_Y_BETWEEN_TILES) + OFFSET_Y_FIRST_TILE;
@@ -94,8 +96,8 @@ void draw_small_tile_text(uint8_t tile_number, const char *text,
   if (NULL == text)
     return;
 
-  uint8_t column = tile_number / 5;
-  uint8_t row = tile_number % 5;
+  uint8_t column = get_tile_column(tile_number);
+  uint8_t row = get_tile_row(tile_number);
   uint32_t left_limit = (column * OFFSET_X_SECOND_COLUMN) +
                         OFFSET_X_LEFT_BORDER + OFFSET_X_CURSOR_POINTER;
   uint32_t right_limit = (column * OFFSET_X_SECOND_COLUMN) +
@@ -103,25 +105,26 @@ void draw_small_tile_text(uint8_t tile_number, const char *text,
   uint32_t x_start_draw = left_limit + 1;
   uint32_t y_start_draw = (row * DISTANCE_Y_BETWEEN_TILES) +
                           OFFSET_Y_FIRST_TILE + TEXT_X_OFFSET_SMALL_TILE;
-  uint32_t text_width = strlen(text) * (FONT_WIDTH + FONT_SPACE);
 
   if (true == center_text)
     {
       x_start_draw = find_x_to_center_text(text, left_limit, right_limit);
     }
 
-  GFX_DrawFillRectangle(x_start_draw, y_start_draw, text_width, FONT_HEIGHT,
-                        HMI_BACKGROUND_COLOR);
+  // erase whole text line - previous text could be longer
+  GFX_DrawFillRectangle(left_limit + LINE_SIZE, y_start_draw,
+                        right_limit - left_limit - (2 * LINE_SIZE),
+                        FONT_HEIGHT, HMI_BACKGROUND_COLOR);
 
-  GFX_DrawString(x_start_draw, y_start_draw, "TIMEOUT", HMI_TEXT_COLOR);
+  GFX_DrawString(x_start_draw, y_start_draw, text, HMI_TEXT_COLOR);
 
   return;
 }
 
 void draw_main_menu_cursor(ColorType color, uint8_t active_tile)
 {
-  uint8_t column = active_tile / 5;
-  uint8_t row = active_tile % 5;
+  uint8_t column = get_tile_column(active_tile);
+  uint8_t row = get_tile_row(active_tile);
 
   uint32_t x0_pos =
       (column * OFFSET_X_SECOND_COLUMN) + LINE_SIZE + OFFSET_X_LEFT_BORDER;
@@ -145,17 +148,56 @@ void draw_main_menu_cursor(ColorType color, uint8_t active_tile)
   return;
 }
 
-void draw_main_screen(uint8_t active_tile)
+/*
+ * Main screen is drawn in horizontal bands - header, then one row of small
+ * tiles of the page of active_tile. Every band is cleared with a single
+ * area fill, the caller can give the CPU away between bands. Returns true
+ * after the last band.
+ */
+bool draw_main_screen_band(uint8_t band, uint8_t active_tile)
 {
-  ILI9341_ClearDisplay(HMI_BACKGROUND_COLOR);
-  draw_wide_tile("XGB PLC COMMUNICATION", 0, true, HMI_TILE_COLOR);
-  for (uint8_t i = 0; i < 10; i++)
+  uint8_t page = active_tile / HMI_TILES_PER_PAGE;
+  uint8_t first_tile = page * HMI_TILES_PER_PAGE;
+  uint8_t row;
+  uint32_t y_pos;
+  uint32_t height = DISTANCE_Y_BETWEEN_TILES;
+
+  if (0 == band)
     {
-      draw_small_tile(i, NULL, false);
+      char header[32];
+
+      sprintf(header, "XGB PLC COMMUNICATION %u/%u", page + 1U,
+              HMI_NO_PAGES);
+      ILI9341_FillArea(0, 0, ILI9341_TFTWIDTH, OFFSET_Y_FIRST_TILE,
+                       HMI_BACKGROUND_COLOR);
+      draw_wide_tile(header, 0, true, HMI_TILE_COLOR);
+      return false;
     }
 
-  draw_main_menu_cursor(HMI_CURSOR_COLOR, active_tile);
-  return;
+  row = band - 1;
+  y_pos = (row * DISTANCE_Y_BETWEEN_TILES) + OFFSET_Y_FIRST_TILE;
+
+  // last band takes the rest of the screen
+  if (HMI_TILE_ROWS - 1 == row)
+    {
+      height = ILI9341_TFTHEIGHT - y_pos;
+    }
+
+  ILI9341_FillArea(0, y_pos, ILI9341_TFTWIDTH, height, HMI_BACKGROUND_COLOR);
+
+  for (uint8_t column = 0; column < HMI_TILE_COLUMNS; column++)
+    {
+      uint8_t tile_number = first_tile + (column * HMI_TILE_ROWS) + row;
+
+      draw_small_tile(tile_number, NULL, false);
+
+      if (tile_number == active_tile)
+        {
+          draw_main_menu_cursor(HMI_CURSOR_COLOR, active_tile);
+        }
+    }
+
+  return (HMI_TILE_ROWS - 1 == row);
 }
 
 void draw_edit_menu(uint8_t active_main_tile)
@@ -164,11 +206,12 @@ void draw_edit_menu(uint8_t active_main_tile)
   ILI9341_ClearDisplay(HMI_EDIT_MENU_COLOR);
 
   char message[16] = {0};
-  sprintf(message, "TILE NUMBER %d", active_main_tile);
+  sprintf(message, "TILE NUMBER %02u", active_main_tile);
 
   const char *tile_text[] = {
-      message,        "Tile function:",  "Device Type:",
-      "Device Size:", "Device Address:", "Confirm - Discard"};
+      message,           "Tile function:", "Device Type:",
+      "Device Size:",    "Poll rate:",     "Deadband:",
+      "Device Address:", "Station:",       "Confirm - Discard"};
 
   draw_wide_tile(tile_text[TILE_HEADER], TILE_HEADER, true, HMI_TILE_COLOR);
 
@@ -226,6 +269,28 @@ void draw_address_char(const hmi_edit_cursors_t *p_cursors)
   return;
 }
 
+void draw_station_switch(const hmi_edit_cursors_t *p_cursors)
+{
+  char station_text[8];
+
+  sprintf(station_text, "<%02u>", (unsigned int)p_cursors->horiz_station);
+
+  uint32_t x_start_text =
+      find_x_to_center_text(station_text, STD_SW_LEFT_LIMIT, STD_SW_RIGHT_LIMIT);
+
+  uint32_t y_start_text =
+      ((GAP_Y_BETWEEN_TILES + WIDE_TILE_HEIGHT) * TILE_STATION) +
+      TEXT_Y_OFFSET_WIDE_TILE;
+
+  GFX_DrawFillRectangle(x_start_text, y_start_text,
+                        strlen(station_text) * (FONT_WIDTH + FONT_SPACE),
+                        FONT_HEIGHT, HMI_EDIT_MENU_COLOR);
+
+  GFX_DrawString(x_start_text, y_start_text, station_text, HMI_TEXT_COLOR);
+
+  return;
+}
+
 void draw_exit_cursor(const hmi_edit_cursors_t *p_cursors, ColorType color)
 {
 
@@ -271,10 +336,11 @@ void draw_address_cursor(const hmi_edit_cursors_t *p_cursors, ColorType color)
   return;
 }
 
-void draw_update_header_number(char new_number)
+void draw_update_header_number(uint8_t tile_number)
 {
+  char number_text[3];
   uint32_t x_start_draw =
-      find_x_to_center_text("TILE NUMBER  ", OFFSET_X_LEFT_BORDER,
+      find_x_to_center_text("TILE NUMBER 00", OFFSET_X_LEFT_BORDER,
                             (ILI9341_TFTWIDTH - OFFSET_X_LEFT_BORDER));
 
   x_start_draw =
@@ -284,10 +350,12 @@ void draw_update_header_number(char new_number)
       ((GAP_Y_BETWEEN_TILES + WIDE_TILE_HEIGHT) * TILE_HEADER) +
       TEXT_Y_OFFSET_WIDE_TILE;
 
-  GFX_DrawFillRectangle(x_start_draw, y_start_draw, FONT_WIDTH, FONT_HEIGHT,
+  GFX_DrawFillRectangle(x_start_draw, y_start_draw,
+                        (2 * FONT_WIDTH) + FONT_SPACE, FONT_HEIGHT,
                         HMI_EDIT_MENU_COLOR);
 
-  GFX_DrawChar(x_start_draw, y_start_draw, new_number, HMI_TEXT_COLOR);
+  sprintf(number_text, "%02u", tile_number);
+  GFX_DrawString(x_start_draw, y_start_draw, number_text, HMI_TEXT_COLOR);
 
   return;
 }
@@ -349,6 +417,7 @@ void draw_cursors_initial_values(const hmi_edit_cursors_t *p_cursors,
     }
 
   draw_initial_address_switch();
+  draw_station_switch(p_cursors);
 
   /* Tile selection cursor */
   draw_wide_tile(NULL, TILE_HEADER, false, HMI_HIGHLIGHT_TILE_COLOR);
@@ -396,10 +465,18 @@ static uint32_t get_switch_cursor_val(const hmi_edit_cursors_t *p_cursors)
     case (TILE_SIZE):
       position = p_cursors->horiz_size;
       break;
+    case (TILE_POLL):
+      position = p_cursors->horiz_poll;
+      break;
+    case (TILE_DEADBAND):
+      position = p_cursors->horiz_deadband;
+      break;
     case (TILE_HEADER):
       /* FALLTHORUGH */
     case (TILE_ADDRESS):
       /* FALLTHORUGH */
+    case (TILE_STATION):
+      /* FALLTHORUGH */
     case (TILE_EXIT):
       /* FALLTHORUGH */
     default:
@@ -408,3 +485,16 @@ static uint32_t get_switch_cursor_val(const hmi_edit_cursors_t *p_cursors)
 
   return position;
 }
+
+/*
+ * Tiles of every page take the same places on the screen
+ */
+static uint8_t get_tile_column(uint8_t tile_number)
+{
+  return (tile_number % HMI_TILES_PER_PAGE) / HMI_TILE_ROWS;
+}
+
+static uint8_t get_tile_row(uint8_t tile_number)
+{
+  return (tile_number % HMI_TILES_PER_PAGE) % HMI_TILE_ROWS;
+}
@@ -5,23 +5,34 @@
  *      Author: ROJEK
  */
 
+#include "stdlib.h"
 #include "string.h"
 
 #include "5buttons.h"
 
 #include "hmi.h"
+#include "hmi_config.h"
 #include "hmi_draw.h"
 #include "hmi_edit_menu.h"
 #include "hmi_main_menu.h"
+#include "hmi_poll.h"
 
 #define CONFIRM 0U
 #define DISCARD 1U
 
 /* possible chars 0-9 */
 #define NO_ADDRESS_CHARS 10U
-#define NO_EDIT_MENU_TILES 6U
+#define NO_EDIT_MENU_TILES 9U
+#define NO_STATIONS (XGB_MAX_STATION_NUMBER + 1U)
 
-#define NO_OPTIONS_FUNCTION (sizeof(fun_switch))
+#define NO_OPTIONS_FUNCTION (sizeof(fun_switch) / sizeof(fun_switch[0]))
+#define NO_OPTIONS_POLL (sizeof(poll_switch) / sizeof(poll_switch[0]))
+#define NO_OPTIONS_DEADBAND                                                    \
+  (sizeof(deadband_switch) / sizeof(deadband_switch[0]))
+
+/* first option of the poll and deadband switches keeps the defaults of the
+ * tile kind */
+#define OPTION_AUTO 0U
 
 extern hmi_main_screen_t main_screen_data;
 
@@ -29,7 +40,7 @@ static hmi_edit_cursors_t edit_menu_cursors = {0};
 
 static const edit_option_t fun_switch[] = {{"<READ>", READ},
                                            {"<WRITE_CONT>", WRITE_CONT},
-                                           {"<WRTIE_SINGLE>", WRITE_SINGLE}};
+                                           {"<WRITE_SINGLE>", WRITE_SINGLE}};
 
 static const edit_option_t device_switch[] = {
     {"<P>", XGB_DEV_TYPE_P}, {"<M>", XGB_DEV_TYPE_M}, {"<K>", XGB_DEV_TYPE_K},
@@ -43,13 +54,35 @@ static const edit_option_t size_switch[] = {{"<BIT>", XGB_DATA_SIZE_BIT},
                                             {"<DWORD>", XGB_DATA_SIZE_DWORD},
                                             {"<LWORD>", XGB_DATA_SIZE_LWORD}};
 
-/* Standard switches are in places 1,2,3 so i fill position 0 with null switch*/
+/* frame letter is the priority, period is in poll_switch_period_ms */
+static const edit_option_t poll_switch[] = {
+    {"<AUTO>", POLL_PRIO_NORMAL},     {"<HIGH 0.1 s>", POLL_PRIO_HIGH},
+    {"<HIGH 0.5 s>", POLL_PRIO_HIGH}, {"<NORMAL 1 s>", POLL_PRIO_NORMAL},
+    {"<NORMAL 2 s>", POLL_PRIO_NORMAL}, {"<LOW 5 s>", POLL_PRIO_LOW},
+    {"<LOW 10 s>", POLL_PRIO_LOW}};
+
+static const uint16_t poll_switch_period_ms[NO_OPTIONS_POLL] = {
+    0U, 100U, 500U, 1000U, 2000U, 5000U, 10000U};
+
+/* frame letter is the percent of the value, counts are in
+ * deadband_switch_counts */
+static const edit_option_t deadband_switch[] = {
+    {"<AUTO>", 0}, {"<EXACT>", 0},  {"<1 %>", 1},       {"<5 %>", 5},
+    {"<10 %>", 10}, {"<1 COUNT>", 0}, {"<10 COUNTS>", 0}, {"<100 COUNTS>", 0}};
+
+static const uint16_t deadband_switch_counts[NO_OPTIONS_DEADBAND] = {
+    0U, 0U, 0U, 0U, 0U, 1U, 10U, 100U};
+
+/* Standard switches are in places 1-5 so i fill position 0 with null switch*/
 static const edit_option_t null_switch[] = {};
 
-static const edit_option_t *std_switches[] = {null_switch, fun_switch,
-                                              device_switch, size_switch};
+static const edit_option_t *std_switches[] = {
+    null_switch, fun_switch,  device_switch,
+    size_switch, poll_switch, deadband_switch};
 
 static void init_edit_menu_cursors(void);
+static void step_station_switch(uint8_t step);
+static bool keep_station_allowed(void);
 static hmi_change_screen_t edit_menu_if_button_pressed(void);
 static void save_data_to_tile(void);
 
@@ -62,25 +95,15 @@ void em_open_edit_menu(void)
   return;
 }
 
-/* Active screen super loop */
+/* Input task step of the edit screen */
 hmi_change_screen_t em_active_screen(void)
 {
+  hmi_change_screen_t ret_action = edit_menu_if_button_pressed();
 
-  hmi_change_screen_t ret_action = OPEN_MAIN_MENU;
-
-  while (1)
+  if (SAVE_DATA_TO_TILE == ret_action)
     {
-      ret_action = edit_menu_if_button_pressed();
-
-      if (NO_CHANGE != ret_action)
-        {
-          if (SAVE_DATA_TO_TILE == ret_action)
-            {
-              save_data_to_tile();
-              ret_action = OPEN_MAIN_MENU;
-            }
-          break;
-        }
+      save_data_to_tile();
+      ret_action = OPEN_MAIN_MENU;
     }
 
   return ret_action;
@@ -88,6 +111,41 @@ hmi_change_screen_t em_active_screen(void)
 
 /*** HORIZONTAL CURSOR FUNCTIONS **/
 
+/*
+ * Station switch skips stations that have no room in the station
+ * statistics. Stations of the other tiles are always allowed, so the loop
+ * ends.
+ */
+static void step_station_switch(uint8_t step)
+{
+  do
+    {
+      edit_menu_cursors.horiz_station =
+          (edit_menu_cursors.horiz_station + step) % NO_STATIONS;
+    }
+  while (false ==
+         poll_is_station_allowed(main_screen_data.active_main_tile,
+                                 edit_menu_cursors.horiz_station));
+
+  return;
+}
+
+/*
+ * Returns true if the station had to be changed for the edited tile
+ */
+static bool keep_station_allowed(void)
+{
+  if (true == poll_is_station_allowed(main_screen_data.active_main_tile,
+                                      edit_menu_cursors.horiz_station))
+    {
+      return false;
+    }
+
+  step_station_switch(1);
+
+  return true;
+}
+
 static void update_horiz_cursor_val(buttons_state_t pending_flag)
 {
   if (pending_flag == LEFT_FLAG)
@@ -95,7 +153,9 @@ static void update_horiz_cursor_val(buttons_state_t pending_flag)
       switch (edit_menu_cursors.vert_tile)
         {
         case (TILE_FUNCTION):
-          edit_menu_cursors.horiz_fun = (edit_menu_cursors.horiz_fun + 1) % 2;
+          edit_menu_cursors.horiz_fun =
+              (edit_menu_cursors.horiz_fun + NO_OPTIONS_FUNCTION - 1) %
+              NO_OPTIONS_FUNCTION;
           break;
         case (TILE_DEVICE):
           edit_menu_cursors.horiz_dev = (edit_menu_cursors.horiz_dev + 11) % 12;
@@ -103,10 +163,23 @@ static void update_horiz_cursor_val(buttons_state_t pending_flag)
         case (TILE_SIZE):
           edit_menu_cursors.horiz_size = (edit_menu_cursors.horiz_size + 4) % 5;
           break;
+        case (TILE_POLL):
+          edit_menu_cursors.horiz_poll =
+              (edit_menu_cursors.horiz_poll + NO_OPTIONS_POLL - 1) %
+              NO_OPTIONS_POLL;
+          break;
+        case (TILE_DEADBAND):
+          edit_menu_cursors.horiz_deadband =
+              (edit_menu_cursors.horiz_deadband + NO_OPTIONS_DEADBAND - 1) %
+              NO_OPTIONS_DEADBAND;
+          break;
         case (TILE_ADDRESS):
           edit_menu_cursors.horiz_address =
               (edit_menu_cursors.horiz_address + 5) % 6;
           break;
+        case (TILE_STATION):
+          step_station_switch(NO_STATIONS - 1);
+          break;
         case (TILE_EXIT):
           edit_menu_cursors.horiz_exit = (edit_menu_cursors.horiz_exit + 1) % 2;
           break;
@@ -121,7 +194,8 @@ static void update_horiz_cursor_val(buttons_state_t pending_flag)
       switch (edit_menu_cursors.vert_tile)
         {
         case (TILE_FUNCTION):
-          edit_menu_cursors.horiz_fun = (edit_menu_cursors.horiz_fun + 1) % 2;
+          edit_menu_cursors.horiz_fun =
+              (edit_menu_cursors.horiz_fun + 1) % NO_OPTIONS_FUNCTION;
           break;
         case (TILE_DEVICE):
           edit_menu_cursors.horiz_dev = (edit_menu_cursors.horiz_dev + 1) % 12;
@@ -129,10 +203,21 @@ static void update_horiz_cursor_val(buttons_state_t pending_flag)
         case (TILE_SIZE):
           edit_menu_cursors.horiz_size = (edit_menu_cursors.horiz_size + 1) % 5;
           break;
+        case (TILE_POLL):
+          edit_menu_cursors.horiz_poll =
+              (edit_menu_cursors.horiz_poll + 1) % NO_OPTIONS_POLL;
+          break;
+        case (TILE_DEADBAND):
+          edit_menu_cursors.horiz_deadband =
+              (edit_menu_cursors.horiz_deadband + 1) % NO_OPTIONS_DEADBAND;
+          break;
         case (TILE_ADDRESS):
           edit_menu_cursors.horiz_address =
               (edit_menu_cursors.horiz_address + 1) % 6;
           break;
+        case (TILE_STATION):
+          step_station_switch(1);
+          break;
         case (TILE_EXIT):
           edit_menu_cursors.horiz_exit = (edit_menu_cursors.horiz_exit + 1) % 2;
           break;
@@ -146,7 +231,7 @@ static void update_horiz_cursor_val(buttons_state_t pending_flag)
   return;
 }
 
-/* Standard switches : function,device,size */
+/* Standard switches : function,device,size,poll rate,deadband */
 static void redraw_horiz_std_switch(buttons_state_t pending_flag)
 {
   draw_erase_std_switch_text(&edit_menu_cursors, std_switches);
@@ -163,7 +248,8 @@ static void redraw_horiz_address_switch(buttons_state_t pending_flag)
 
   /* Save char to main menu data */
   edit_menu_cursors.vert_address_num =
-      (uint8_t)edit_menu_cursors.address[edit_menu_cursors.horiz_address];
+      (uint8_t)(edit_menu_cursors.address[edit_menu_cursors.horiz_address] -
+                '0');
 
   if (true == edit_menu_cursors.is_edit_mode_active)
     {
@@ -177,6 +263,14 @@ static void redraw_horiz_address_switch(buttons_state_t pending_flag)
   return;
 }
 
+static void redraw_horiz_station_switch(buttons_state_t pending_flag)
+{
+  update_horiz_cursor_val(pending_flag);
+  draw_station_switch(&edit_menu_cursors);
+
+  return;
+}
+
 static void redraw_horiz_exit_switch(buttons_state_t pending_flag)
 {
   draw_exit_cursor(&edit_menu_cursors, HMI_EDIT_MENU_COLOR);
@@ -192,16 +286,22 @@ static void redraw_horiz_header(buttons_state_t pending_flag)
 
   if (RIGHT_FLAG == pending_flag)
     {
-      active_tile = (active_tile + 1) % 10;
+      active_tile = (active_tile + 1) % HMI_NO_TILES;
     }
   else if (LEFT_FLAG == pending_flag)
     {
-      active_tile = (active_tile + 9) % 10;
+      active_tile = (active_tile + HMI_NO_TILES - 1) % HMI_NO_TILES;
     }
 
   main_screen_data.active_main_tile = active_tile;
 
-  draw_update_header_number(active_tile + '0');
+  draw_update_header_number(active_tile);
+
+  // other tile could leave no room for the station chosen so far
+  if (true == keep_station_allowed())
+    {
+      draw_station_switch(&edit_menu_cursors);
+    }
 
   return;
 }
@@ -276,6 +376,10 @@ static void select_horiz_cursor_to_edit(buttons_state_t pending_flag)
     case (TILE_FUNCTION):
       /* FALLTHORUGH */
     case (TILE_SIZE):
+      /* FALLTHORUGH */
+    case (TILE_POLL):
+      /* FALLTHORUGH */
+    case (TILE_DEADBAND):
       redraw_horiz_std_switch(pending_flag);
       break;
 
@@ -283,6 +387,10 @@ static void select_horiz_cursor_to_edit(buttons_state_t pending_flag)
       redraw_horiz_address_switch(pending_flag);
       break;
 
+    case (TILE_STATION):
+      redraw_horiz_station_switch(pending_flag);
+      break;
+
     case (TILE_EXIT):
       redraw_horiz_exit_switch(pending_flag);
       break;
@@ -300,7 +408,7 @@ static void redraw_vert_address_char(buttons_state_t pending_flag)
   update_vert_cursor_val(pending_flag);
   draw_address_char(&edit_menu_cursors);
   edit_menu_cursors.address[edit_menu_cursors.horiz_address] =
-      (char)edit_menu_cursors.vert_address_num;
+      (char)(edit_menu_cursors.vert_address_num + '0');
 
   return;
 }
@@ -407,6 +515,12 @@ static hmi_change_screen_t action_if_enter_pressed(buttons_state_t pending_flag)
       /* FALLTHORUGH */
     case (TILE_FUNCTION):
       /* FALLTHORUGH */
+    case (TILE_POLL):
+      /* FALLTHORUGH */
+    case (TILE_DEADBAND):
+      /* FALLTHORUGH */
+    case (TILE_STATION):
+      /* FALLTHORUGH */
     default:
       break;
     }
@@ -416,43 +530,19 @@ static hmi_change_screen_t action_if_enter_pressed(buttons_state_t pending_flag)
   return ret_action;
 }
 
-static tile_callback_t get_callback_to_tile(tile_function_t tile_function)
-{
-  tile_callback_t ret_ptr = NULL;
-
-  switch (tile_function)
-    {
-    case (READ):
-      {
-        ret_ptr = &mm_read_tile_function;
-        break;
-      }
-    case (WRITE_CONT):
-      {
-        ret_ptr = NULL;
-        break;
-      }
-    case (WRITE_SINGLE):
-      {
-        ret_ptr = NULL;
-        break;
-      }
-    default:
-      break;
-    }
-
-  return ret_ptr;
-}
-
 static void init_edit_menu_cursors(void)
 {
-  memcpy(&edit_menu_cursors.address, "00000", 6);
+  memcpy(&edit_menu_cursors.address, "000000", HMI_ADDRESS_DIGITS + 1U);
   edit_menu_cursors.is_edit_mode_active = false;
   edit_menu_cursors.horiz_address = 0;
   edit_menu_cursors.horiz_dev = 0;
   edit_menu_cursors.horiz_exit = 0;
   edit_menu_cursors.horiz_fun = 0;
   edit_menu_cursors.horiz_size = 0;
+  edit_menu_cursors.horiz_poll = OPTION_AUTO;
+  edit_menu_cursors.horiz_deadband = OPTION_AUTO;
+  edit_menu_cursors.horiz_station = XGB_DEFAULT_STATION;
+  keep_station_allowed();
   edit_menu_cursors.vert_address_num = 0;
   edit_menu_cursors.vert_tile = TILE_HEADER;
 
@@ -494,23 +584,44 @@ static hmi_change_screen_t edit_menu_if_button_pressed(void)
 static void save_data_to_tile(void)
 {
   uint8_t save_tile_number = main_screen_data.active_main_tile;
-  uint8_t save_device = edit_menu_cursors.horiz_dev;
-  uint8_t save_size = edit_menu_cursors.horiz_size;
-  uint8_t save_function = edit_menu_cursors.horiz_fun;
+  hmi_tile_config_t config;
+
+  // padding is saved to flash too
+  memset(&config, 0, sizeof(config));
 
   /* Copy all the significant data*/
-  main_screen_data.tiles[save_tile_number].data.tile_number = save_tile_number;
-  main_screen_data.tiles[save_tile_number].data.device_type =
-      device_switch[save_device].frame_letter;
-  main_screen_data.tiles[save_tile_number].data.size_mark =
-      size_switch[save_size].frame_letter;
-  main_screen_data.tiles[save_tile_number].data.function =
-      fun_switch[save_function].frame_letter;
-  memcpy(main_screen_data.tiles[save_tile_number].data.address,
-         &(edit_menu_cursors.address), 6);
-
-  main_screen_data.tiles[save_tile_number].callback =
-      get_callback_to_tile(save_function);
+  config.station_number = edit_menu_cursors.horiz_station;
+  config.device_type = device_switch[edit_menu_cursors.horiz_dev].frame_letter;
+  config.size_mark = size_switch[edit_menu_cursors.horiz_size].frame_letter;
+  config.function = fun_switch[edit_menu_cursors.horiz_fun].frame_letter;
+  config.address = strtoul(edit_menu_cursors.address, NULL, 10);
+  poll_set_default_rate(&config);
+  mm_set_default_deadband(&config);
+
+  if (OPTION_AUTO != edit_menu_cursors.horiz_poll)
+    {
+      config.priority = poll_switch[edit_menu_cursors.horiz_poll].frame_letter;
+      config.poll_period_ms =
+          poll_switch_period_ms[edit_menu_cursors.horiz_poll];
+    }
+
+  if (OPTION_AUTO != edit_menu_cursors.horiz_deadband)
+    {
+      config.deadband_percent =
+          deadband_switch[edit_menu_cursors.horiz_deadband].frame_letter;
+      config.deadband =
+          deadband_switch_counts[edit_menu_cursors.horiz_deadband];
+    }
+
+  main_screen_data.tiles.config[save_tile_number] = config;
+  main_screen_data.tiles.flags[save_tile_number] |= HMI_TILE_CONFIGURED;
+  main_screen_data.tiles.flags[save_tile_number] &= ~HMI_TILE_WRITE_PENDING;
+  // value of the old device is not shown, the tile waits for the new one
+  main_screen_data.tiles.value[save_tile_number] = INITIAL_VAL;
+  poll_tile_changed(save_tile_number);
+
+  // tile comes back after power cycle
+  cfg_save_tile(save_tile_number, &config);
 
   return;
 }
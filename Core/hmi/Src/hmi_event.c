@@ -0,0 +1,91 @@
+/*
+ * hmi_event.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: pawel
+ */
+
+#include "main.h"
+#include "stdbool.h"
+
+#include "hmi_event.h"
+
+static volatile uint32_t pending_events;
+static volatile uint32_t wake_tick;
+static volatile bool wake_requested;
+
+/*
+ * Called from interrupts of any priority - PRIMASK is restored, so it can
+ * be called with interrupts off as well
+ */
+void ev_post(uint32_t events)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  pending_events |= events;
+  __set_PRIMASK(primask);
+
+  return;
+}
+
+/*
+ * Sleep until an interrupt posts an event. Interrupts are masked during the
+ * check, WFI still wakes up on the pending one, so an event posted just
+ * before the sleep is never missed.
+ */
+uint32_t ev_wait(void)
+{
+  uint32_t events;
+
+  __disable_irq();
+
+  while (0 == pending_events)
+    {
+      __WFI();
+      // pending interrupt is taken here
+      __enable_irq();
+      __disable_irq();
+    }
+
+  events = pending_events;
+  pending_events = 0;
+
+  __enable_irq();
+
+  return events;
+}
+
+/*
+ * Timer event at the given tick, the earliest of requested ticks wins.
+ * Request is cleared when the event is posted.
+ */
+void ev_wake_at(uint32_t tick)
+{
+  __disable_irq();
+
+  if (false == wake_requested || (int32_t)(tick - wake_tick) < 0)
+    {
+      wake_tick = tick;
+      wake_requested = true;
+    }
+
+  __enable_irq();
+
+  return;
+}
+
+/*
+ * Called from SysTick after the tick was incremented
+ */
+void ev_systick(void)
+{
+  // signed difference survives tick overflow
+  if (true == wake_requested && (int32_t)(HAL_GetTick() - wake_tick) >= 0)
+    {
+      wake_requested = false;
+      ev_post(EV_TIMER);
+    }
+
+  return;
+}
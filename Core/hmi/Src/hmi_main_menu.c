@@ -5,6 +5,7 @@
  *      Author: pawel
  */
 
+#include "assert.h"
 #include "main.h"
 #include "stdio.h"
 #include "string.h"
@@ -12,110 +13,259 @@
 #include "5buttons.h"
 
 #include "hmi.h"
+#include "hmi_config.h"
 #include "hmi_draw.h"
+#include "hmi_event.h"
 #include "hmi_main_menu.h"
+#include "hmi_poll.h"
 #include "xgb_comm.h"
 
-extern UART_HandleTypeDef huart1;
+#define SETPOINT_STEP_MIN 1
+#define SETPOINT_STEP_MAX 10000
+/* frame of the shown page is on the screen */
+#define PAGE_DRAWN 0xFFU
+
+/* Setpoint of write tile edited with the buttons on the main screen */
+typedef struct setpoint_edit
+{
+  bool active;
+  int32_t value;
+  int32_t step;
+} setpoint_edit_t;
+
+static_assert(HMI_NO_TILES <= 99U, "Tile number has two digits on screen");
+
 hmi_main_screen_t main_screen_data;
-static volatile bool frame_returned;
+
+static hmi_tile_table_t *const p_tiles = &main_screen_data.tiles;
+static setpoint_edit_t setpoint_edit = {0};
+/* render starts where the previous one ran out of time */
+static uint8_t next_render_tile;
+/* next band of the page frame, drawn before the values of the page */
+static uint8_t page_band = PAGE_DRAWN;
+/* boot time measure - first PLC value drawn */
+static uint32_t first_value_tick;
 
 static uint8_t update_main_cursor_val(buttons_state_t pending_flag,
                                       uint8_t active_tile);
 static void redraw_main_cursor(buttons_state_t pending_flag);
+static void show_page_of_tile(uint8_t tile_number);
+static uint8_t get_page(uint8_t tile_number);
 static hmi_change_screen_t edit_screen_if_button_pressed(void);
-
-static bool wait_for_frame_until_timeout(void);
-static bool is_new_text_neccessary(char *text_in_tile, const u_frame *new_frame,
-                                   bool timeout, hmi_tile_t *p_tile);
-static void call_tile_function(uint8_t tile_number);
-
+static hmi_change_screen_t setpoint_if_button_pressed(
+    buttons_state_t pending_flag);
+static void start_setpoint_edit(void);
+static void draw_setpoint_edit(void);
+static bool is_write_tile(uint8_t tile_number);
+static bool is_bit_tile(uint8_t tile_number);
+static void clamp_setpoint(void);
+
+static bool is_new_text_neccessary(char *text_in_tile, int32_t new_value,
+                                   uint8_t tile_number);
+static bool is_status_val(int32_t value);
+static bool is_outside_deadband(uint8_t tile_number, int32_t new_val);
+
+/* Input task step of the main screen, PLC values are drawn by
+ * mm_render_tiles */
 hmi_change_screen_t mm_active_screen(void)
 {
-  hmi_change_screen_t ret_action = NO_CHANGE;
+  return edit_screen_if_button_pressed();
+}
+
+/*
+ * Render task: frame of a newly shown page first, band by band, then the
+ * values stored by mm_store_tile_value, for at most budget_ms. Only tiles
+ * of the shown page are drawn, the others keep their repaint flag. Returns
+ * true if some work is left for the next run.
+ */
+bool mm_render_tiles(uint32_t budget_ms)
+{
+  uint32_t start_tick = HAL_GetTick();
+  uint8_t first_tile =
+      get_page(main_screen_data.active_main_tile) * HMI_TILES_PER_PAGE;
 
-  while (1)
+  while (PAGE_DRAWN != page_band)
     {
-      for (uint8_t i = 0; i < 10; i++)
+      if (HAL_GetTick() - start_tick >= budget_ms)
         {
-          call_tile_function(i);
-          ret_action = edit_screen_if_button_pressed();
+          return true;
+        }
+
+      page_band = (true == draw_main_screen_band(
+                               page_band, main_screen_data.active_main_tile))
+                      ? PAGE_DRAWN
+                      : page_band + 1U;
+    }
+
+  for (uint8_t i = 0; i < HMI_TILES_PER_PAGE; i++)
+    {
+      uint8_t tile_number =
+          first_tile + ((next_render_tile + i) % HMI_TILES_PER_PAGE);
+      char msg_to_print[16];
+
+      if (0 == (p_tiles->flags[tile_number] & HMI_TILE_REPAINT_PENDING))
+        {
+          continue;
+        }
+
+      if (HAL_GetTick() - start_tick >= budget_ms)
+        {
+          next_render_tile = tile_number % HMI_TILES_PER_PAGE;
+          return true;
+        }
+
+      p_tiles->flags[tile_number] &= ~HMI_TILE_REPAINT_PENDING;
 
-          if (NO_CHANGE != ret_action)
+      // tile shows the setpoint being edited instead of the value
+      if (true == setpoint_edit.active &&
+          main_screen_data.active_main_tile == tile_number)
+        {
+          continue;
+        }
+
+      if (is_new_text_neccessary(msg_to_print, p_tiles->value[tile_number],
+                                 tile_number))
+        {
+          draw_small_tile_text(tile_number, msg_to_print, true);
+
+          if (0 == first_value_tick &&
+              false == is_status_val(p_tiles->value[tile_number]))
             {
-              return ret_action;
+              first_value_tick = HAL_GetTick();
             }
         }
     }
+
+  return false;
+}
+
+uint32_t mm_get_first_value_tick(void)
+{
+  return first_value_tick;
+}
+
+/*
+ * Screen is drawn by the render task, cursor stays on the tile that was
+ * chosen in the edit menu
+ */
+void mm_open_main_screen(void)
+{
+  show_page_of_tile(main_screen_data.active_main_tile);
+
+  return;
 }
 
 void mm_write_initial_values_to_tiles(void)
 {
-  main_screen_data.active_main_tile = 0;
+  setpoint_edit.active = false;
 
-  for (uint8_t i = 0; i < 10; i++)
+  for (uint8_t i = 0; i < HMI_NO_TILES; i++)
     {
-      main_screen_data.tiles[i].value = INITIAL_VAL;
+      p_tiles->value[i] = INITIAL_VAL;
+      p_tiles->shown_value[i] = INITIAL_VAL;
+      p_tiles->flags[i] &= ~HMI_TILE_REPAINT_PENDING;
     }
 
+  poll_schedule_all_now();
+
   return;
 }
 
-#if (HMI_MOCK_COMM_READ == 0U)
-void mm_read_tile_function(const struct frame_data *frame_send)
+/*
+ * Bits and setpoints are shown exactly, analog values filter the noise
+ */
+void mm_set_default_deadband(hmi_tile_config_t *p_config)
 {
-  frame_returned = false;
-  bool timeout_error = false;
-  char msg_to_print[16];
-  u_frame *p_frame_received = {0};
-  hmi_tile_t *p_edited_tile = &main_screen_data.tiles[frame_send->tile_number];
-
-  HAL_UARTEx_ReceiveToIdle_DMA(&huart1, (uint8_t *)p_frame_received,
-                               MAX_FRAME_SIZE);
+  p_config->deadband = 0;
+  p_config->deadband_percent = 0;
 
-  xgb_read_single_device(frame_send->device_type, frame_send->size_mark,
-                         frame_send->address);
+  if (READ == p_config->function && XGB_DATA_SIZE_BIT != p_config->size_mark)
+    {
+      p_config->deadband_percent = HMI_DEADBAND_PERCENT_DEFAULT;
+    }
 
-  timeout_error = wait_for_frame_until_timeout();
+  return;
+}
 
-  if (is_new_text_neccessary(msg_to_print, p_frame_received, timeout_error,
-                             p_edited_tile))
+/*
+ * Tiles saved in flash are set up before the first screen
+ */
+void mm_restore_tiles(void)
+{
+  for (uint8_t i = 0; i < HMI_NO_TILES; i++)
     {
-      draw_small_tile_text(frame_send->tile_number, msg_to_print, true);
+      if (true == cfg_load_tile(i, &p_tiles->config[i]))
+        {
+          p_tiles->flags[i] |= HMI_TILE_CONFIGURED;
+        }
     }
 
   return;
 }
-#endif /* (HMI_MOCK_COMM_READ == 0U) */
 
-void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
+/*
+ * Poll scheduler hands over the new value (or TIMEOUT_VAL / NAK_VAL /
+ * STALE_VAL) in the comm task - value is only stored, the screen is left to
+ * the render task. Values keep coming while the edit menu is open. Write
+ * tiles show the value read back from PLC (or the setpoint after ACK).
+ */
+void mm_store_tile_value(uint8_t tile_number, int32_t new_value)
 {
-  frame_returned = true;
+  p_tiles->value[tile_number] = new_value;
+  p_tiles->flags[tile_number] |= HMI_TILE_REPAINT_PENDING;
+  ev_post(EV_RENDER);
+
+  return;
 }
 
+/*
+ * Tiles are numbered column by column within the page. LEFT / RIGHT at the
+ * edge column go to the previous / next page, same row.
+ */
 static uint8_t update_main_cursor_val(buttons_state_t pending_flag,
                                       uint8_t active_tile)
 {
+  uint8_t page = get_page(active_tile);
+  uint8_t slot = active_tile % HMI_TILES_PER_PAGE;
+  uint8_t column = slot / HMI_TILE_ROWS;
+  uint8_t row = slot % HMI_TILE_ROWS;
+
   switch (pending_flag)
     {
     case (LEFT_FLAG):
       {
-        active_tile = (active_tile + 5) % 10;
+        if (0 == column)
+          {
+            page = (page + HMI_NO_PAGES - 1U) % HMI_NO_PAGES;
+            column = HMI_TILE_COLUMNS - 1U;
+          }
+        else
+          {
+            column--;
+          }
         break;
       }
     case (RIGHT_FLAG):
       {
-        active_tile = (active_tile + 5) % 10;
+        if (HMI_TILE_COLUMNS - 1U == column)
+          {
+            page = (page + 1U) % HMI_NO_PAGES;
+            column = 0;
+          }
+        else
+          {
+            column++;
+          }
         break;
       }
     case (UP_FLAG):
       {
-        active_tile = (active_tile + 4) % 5 + (5 * (active_tile / 5));
+        row = (row + HMI_TILE_ROWS - 1U) % HMI_TILE_ROWS;
         break;
       }
     case (DOWN_FLAG):
       {
-        active_tile = (active_tile + 1) % 5 + (5 * (active_tile / 5));
+        row = (row + 1U) % HMI_TILE_ROWS;
         break;
       }
 
@@ -127,27 +277,74 @@ static uint8_t update_main_cursor_val(buttons_state_t pending_flag,
       break;
     }
 
-  return active_tile;
+  return (page * HMI_TILES_PER_PAGE) + (column * HMI_TILE_ROWS) + row;
 }
 
 static void redraw_main_cursor(buttons_state_t pending_flag)
 {
+  uint8_t new_tile =
+      update_main_cursor_val(pending_flag, main_screen_data.active_main_tile);
+
+  if (get_page(new_tile) != get_page(main_screen_data.active_main_tile))
+    {
+      show_page_of_tile(new_tile);
+      return;
+    }
+
   draw_main_menu_cursor(HMI_BACKGROUND_COLOR,
                         main_screen_data.active_main_tile);
-  main_screen_data.active_main_tile =
-      update_main_cursor_val(pending_flag, main_screen_data.active_main_tile);
+  main_screen_data.active_main_tile = new_tile;
   draw_main_menu_cursor(HMI_CURSOR_COLOR, main_screen_data.active_main_tile);
 
   return;
 }
 
+/*
+ * Page is drawn lazily by the render task. Values polled in the background
+ * are shown at once, the poll scheduler reads the page again right away.
+ */
+static void show_page_of_tile(uint8_t tile_number)
+{
+  uint8_t page = get_page(tile_number);
+  uint8_t first_tile = page * HMI_TILES_PER_PAGE;
+
+  main_screen_data.active_main_tile = tile_number;
+  page_band = 0;
+  next_render_tile = 0;
+
+  for (uint8_t i = first_tile; i < first_tile + HMI_TILES_PER_PAGE; i++)
+    {
+      // cleared tile shows nothing yet
+      p_tiles->shown_value[i] = INITIAL_VAL;
+
+      if (INITIAL_VAL != p_tiles->value[i])
+        {
+          p_tiles->flags[i] |= HMI_TILE_REPAINT_PENDING;
+        }
+    }
+
+  poll_set_visible_page(page);
+  ev_post(EV_RENDER | EV_TIMER);
+
+  return;
+}
+
+static uint8_t get_page(uint8_t tile_number)
+{
+  return tile_number / HMI_TILES_PER_PAGE;
+}
+
 static hmi_change_screen_t edit_screen_if_button_pressed(void)
 {
   buttons_state_t pending_flag = buttons_get_pending_flag();
 
   hmi_change_screen_t change_screen = NO_CHANGE;
 
-  if (IDLE != pending_flag)
+  if (true == setpoint_edit.active)
+    {
+      change_screen = setpoint_if_button_pressed(pending_flag);
+    }
+  else if (IDLE != pending_flag)
     {
       switch (pending_flag)
         {
@@ -162,7 +359,14 @@ static hmi_change_screen_t edit_screen_if_button_pressed(void)
           break;
 
         case (ENTER_FLAG):
-          change_screen = OPEN_EDIT_MENU;
+          if (true == is_write_tile(main_screen_data.active_main_tile))
+            {
+              start_setpoint_edit();
+            }
+          else
+            {
+              change_screen = OPEN_EDIT_MENU;
+            }
           break;
         case (IDLE):
           /* FALLTHROUGH */
@@ -175,76 +379,244 @@ static hmi_change_screen_t edit_screen_if_button_pressed(void)
   return change_screen;
 }
 
-static bool wait_for_frame_until_timeout(void)
+/*
+ * UP/DOWN change setpoint by step, LEFT/RIGHT change the step by decade -
+ * bit tiles step between 0 and 1 only. ENTER queues the changed setpoint,
+ * ENTER without change opens edit menu.
+ */
+static hmi_change_screen_t setpoint_if_button_pressed(
+    buttons_state_t pending_flag)
 {
-  uint32_t current_tick = HAL_GetTick();
-  bool timeout_error = false;
-  while (false == frame_returned)
+  uint8_t tile_number = main_screen_data.active_main_tile;
+  hmi_change_screen_t change_screen = NO_CHANGE;
+
+  switch (pending_flag)
     {
-      if (HAL_GetTick() - current_tick > RETURN_FRAME_TIMEOUT)
+    case (UP_FLAG):
+      setpoint_edit.value += setpoint_edit.step;
+      clamp_setpoint();
+      draw_setpoint_edit();
+      break;
+    case (DOWN_FLAG):
+      setpoint_edit.value -= setpoint_edit.step;
+      clamp_setpoint();
+      draw_setpoint_edit();
+      break;
+    case (LEFT_FLAG):
+      if (setpoint_edit.step > SETPOINT_STEP_MIN)
         {
-          timeout_error = true;
-          break;
+          setpoint_edit.step /= 10;
+        }
+      draw_setpoint_edit();
+      break;
+    case (RIGHT_FLAG):
+      if (setpoint_edit.step < SETPOINT_STEP_MAX &&
+          false == is_bit_tile(tile_number))
+        {
+          setpoint_edit.step *= 10;
         }
+      draw_setpoint_edit();
+      break;
+    case (ENTER_FLAG):
+      setpoint_edit.active = false;
+      draw_main_menu_cursor(HMI_CURSOR_COLOR, tile_number);
+
+      if (setpoint_edit.value != p_tiles->value[tile_number])
+        {
+          poll_queue_write(tile_number, setpoint_edit.value);
+          // forces redraw when ACK or NAK comes back
+          p_tiles->value[tile_number] = INITIAL_VAL;
+          p_tiles->shown_value[tile_number] = INITIAL_VAL;
+          draw_small_tile_text(tile_number, "WRITING", true);
+        }
+      else
+        {
+          change_screen = OPEN_EDIT_MENU;
+        }
+      break;
+    case (IDLE):
+      /* FALLTHROUGH */
+    default:
+      break;
     }
 
-  return timeout_error;
+  return change_screen;
 }
 
-static void call_tile_function(uint8_t tile_number)
+/*
+ * Edit starts from the last known value of the tile
+ */
+static void start_setpoint_edit(void)
 {
+  int32_t current_value = p_tiles->value[main_screen_data.active_main_tile];
+
+  setpoint_edit.active = true;
+  setpoint_edit.step = SETPOINT_STEP_MIN;
+  setpoint_edit.value = current_value;
 
-  if (NULL != main_screen_data.tiles[tile_number].callback)
+  if (INITIAL_VAL == current_value || TIMEOUT_VAL == current_value ||
+      NAK_VAL == current_value || STALE_VAL == current_value)
     {
-      main_screen_data.tiles[tile_number].callback(
-          &main_screen_data.tiles[tile_number].data);
+      setpoint_edit.value = 0;
     }
 
+  clamp_setpoint();
+  draw_main_menu_cursor(HMI_HIGHLIGHT_TILE_COLOR,
+                        main_screen_data.active_main_tile);
+  draw_setpoint_edit();
+
   return;
 }
 
-static int32_t parse_text_from_frame(char *new_text,
-                                     const u_frame *p_frame_data, bool timeout)
+static void draw_setpoint_edit(void)
 {
-  int32_t ret_value;
+  char msg_to_print[24];
 
-  if (true == timeout)
+  if (true == is_bit_tile(main_screen_data.active_main_tile))
+    {
+      sprintf(msg_to_print, "%ld", (long)setpoint_edit.value);
+    }
+  else
+    {
+      sprintf(msg_to_print, "%ld [%ld]", (long)setpoint_edit.value,
+              (long)setpoint_edit.step);
+    }
+
+  draw_small_tile_text(main_screen_data.active_main_tile, msg_to_print, true);
+
+  return;
+}
+
+static bool is_write_tile(uint8_t tile_number)
+{
+  return (0 != (p_tiles->flags[tile_number] & HMI_TILE_CONFIGURED) &&
+          READ != p_tiles->config[tile_number].function);
+}
+
+static bool is_bit_tile(uint8_t tile_number)
+{
+  return (XGB_DATA_SIZE_BIT == p_tiles->config[tile_number].size_mark);
+}
+
+/*
+ * Bit is written as a whole data byte, only 00 and 01 are valid for it
+ */
+static void clamp_setpoint(void)
+{
+  if (false == is_bit_tile(main_screen_data.active_main_tile))
+    {
+      return;
+    }
+
+  if (setpoint_edit.value < 0)
+    {
+      setpoint_edit.value = 0;
+    }
+  else if (setpoint_edit.value > 1)
+    {
+      setpoint_edit.value = 1;
+    }
+
+  return;
+}
+
+static void value_to_text(char *new_text, int32_t value)
+{
+  if (TIMEOUT_VAL == value)
     {
       strcpy(new_text, "TIMEOUT");
-      ret_value = TIMEOUT_VAL;
     }
-  else if (p_frame_data->nak_frame.header_nak == XGB_CC_NAK)
+  else if (NAK_VAL == value)
     {
       strcpy(new_text, "NAK");
-      ret_value = NAK_VAL;
+    }
+  else if (STALE_VAL == value)
+    {
+      strcpy(new_text, "OFFLINE");
     }
   else
     {
+      sprintf(new_text, "%ld", (long)value);
     }
 
-  return ret_value;
+  return;
 }
 
-static bool is_new_val_different(int32_t new_val, int32_t current_val)
+/*
+ * Repaint costs SPI time that polling needs - tile is drawn only for a
+ * meaningful change. Errors and the first value are drawn at once. A change
+ * that is held back stays pending and the render task is woken up for it,
+ * after HMI_MIN_REPAINT_MS or, inside the deadband, HMI_FORCED_REPAINT_MS
+ * since the last repaint - the tile does not wait for the next poll.
+ */
+static bool is_new_text_neccessary(char *text_in_tile, int32_t new_value,
+                                   uint8_t tile_number)
 {
-  return ((new_val != current_val) || INITIAL_VAL == current_val);
-}
+  uint32_t now = HAL_GetTick();
+  // signed difference stays right across the tick wrap
+  int32_t since_repaint = (int32_t)(now - p_tiles->repaint_tick[tile_number]);
+  bool draw_new_text = false;
 
-static bool is_new_text_neccessary(char *text_in_tile, const u_frame *new_frame,
-                                   bool timeout, hmi_tile_t *p_tile)
-{
+  p_tiles->value[tile_number] = new_value;
 
-  char new_text[16] = {0};
-  int32_t new_value = parse_text_from_frame(new_text, new_frame, timeout);
-  int32_t current_value = p_tile->value;
-  bool draw_new_text = false;
-  // check if its different than one before
-  if (true == is_new_val_different(new_value, current_value))
+  if (new_value == p_tiles->shown_value[tile_number])
+    {
+      return false;
+    }
+
+  if (true == is_status_val(new_value) ||
+      true == is_status_val(p_tiles->shown_value[tile_number]))
+    {
+      draw_new_text = true;
+    }
+  else if (since_repaint < (int32_t)HMI_MIN_REPAINT_MS)
+    {
+      p_tiles->flags[tile_number] |= HMI_TILE_REPAINT_PENDING;
+      ev_wake_at(p_tiles->repaint_tick[tile_number] + HMI_MIN_REPAINT_MS);
+    }
+  else if (true == is_outside_deadband(tile_number, new_value) ||
+           since_repaint >= (int32_t)HMI_FORCED_REPAINT_MS)
     {
-      strcpy(text_in_tile, new_text);
       draw_new_text = true;
     }
+  else
+    {
+      p_tiles->flags[tile_number] |= HMI_TILE_REPAINT_PENDING;
+      ev_wake_at(p_tiles->repaint_tick[tile_number] + HMI_FORCED_REPAINT_MS);
+    }
+
+  if (true == draw_new_text)
+    {
+      value_to_text(text_in_tile, new_value);
+      p_tiles->shown_value[tile_number] = new_value;
+      p_tiles->repaint_tick[tile_number] = now;
+    }
 
-  p_tile->value = new_value;
   return draw_new_text;
 }
+
+static bool is_status_val(int32_t value)
+{
+  return (TIMEOUT_VAL == value || NAK_VAL == value || INITIAL_VAL == value ||
+          STALE_VAL == value);
+}
+
+/*
+ * Compared with the value on the screen, not the last one received, so slow
+ * drift adds up and is drawn once it leaves the band
+ */
+static bool is_outside_deadband(uint8_t tile_number, int32_t new_val)
+{
+  const hmi_tile_config_t *p_config = &p_tiles->config[tile_number];
+  int32_t shown_val = p_tiles->shown_value[tile_number];
+  // unsigned differences do not overflow for any pair of int32 values
+  uint32_t difference = (new_val > shown_val)
+                            ? (uint32_t)new_val - (uint32_t)shown_val
+                            : (uint32_t)shown_val - (uint32_t)new_val;
+  uint32_t magnitude =
+      (shown_val < 0) ? 0U - (uint32_t)shown_val : (uint32_t)shown_val;
+  uint32_t band =
+      p_config->deadband + (magnitude / 100U) * p_config->deadband_percent;
+
+  return (difference > band);
+}
@@ -0,0 +1,1761 @@
+/*
+ * hmi_poll.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: pawel
+ */
+
+#include "main.h"
+#include "string.h"
+
+#include "hmi.h"
+#include "hmi_config.h"
+#include "hmi_event.h"
+#include "hmi_main_menu.h"
+#include "hmi_poll.h"
+#include "xgb_comm.h"
+#include "xgb_monitor.h"
+#include "xgb_station.h"
+
+#define NO_TILE_FOUND 0xFFU
+#define NO_GROUP 0xFFU
+// tile value is the whole block, not one bit of it
+#define NO_BIT 0xFFU
+/* Immediate repeats of request with corrupted response (BCC error) */
+#define POLL_CORRUPTED_RETRIES 1U
+/* Link speed is taken when that many probes in a row get a valid answer */
+#define POLL_PROBE_ANSWERS 3U
+/* Probe is short, it is answered in few ms even at 9600 bps */
+#define POLL_PROBE_TIMEOUT_MS 100U
+/* Failed requests in a row on the channel after which its speed is probed
+ * again, but not more often than every POLL_LINK_REPROBE_MS */
+#define POLL_LINK_ERROR_LIMIT 8U
+#define POLL_LINK_REPROBE_MS 60000U
+/* main loop wakes up at least this often even with nothing to poll */
+#define POLL_MAX_SLEEP_MS 1000U
+
+/*
+ * Request that is in flight on the channel, response is awaited without
+ * blocking so the other channel and the screen keep running
+ */
+typedef enum poll_step
+{
+  POLL_STEP_IDLE,
+  POLL_STEP_WRITE,
+  POLL_STEP_REGISTER,
+  POLL_STEP_READ,
+  POLL_STEP_PROBE
+} poll_step_t;
+
+typedef struct poll_request
+{
+  xgb_channel_t *p_channel;
+  poll_step_t step;
+  xgb_frame_type_t frame_type;
+  /* expected response on the wire at the link speed */
+  uint32_t reply_ms;
+  uint8_t station_number;
+  bool station_was_online;
+  uint8_t retries;
+  /* tiles served by the request and the block (device) of each of them,
+   * tiles with the same device share one block, bit tiles can take one
+   * bit of a word block */
+  uint8_t batch[HMI_NO_TILES];
+  uint8_t tile_block[HMI_NO_TILES];
+  uint8_t tile_bit[HMI_NO_TILES];
+  uint8_t batch_size;
+  xgb_device_t devices[XGB_MAX_BLOCKS];
+  char addresses[XGB_MAX_BLOCKS][HMI_ADDRESS_DIGITS + 1U];
+  int32_t values[XGB_MAX_BLOCKS];
+  uint8_t no_blocks;
+  bool continuous_write;
+  xgb_monitor_state_t monitor_state;
+  uint8_t monitor_slot;
+  uint8_t register_number;
+} poll_request_t;
+
+/*
+ * Tiles of one station, page and priority that are read with one frame.
+ * Groups are fixed after every change of config, so each one keeps its
+ * monitor register and always reads exactly the same blocks.
+ */
+typedef struct poll_group
+{
+  uint8_t station_number;
+  uint8_t no_blocks;
+  uint8_t monitor_slot;
+} poll_group_t;
+
+/*
+ * Current request waits for its response while the next one is already
+ * serialized and armed behind it, so the bus never idles between frames
+ */
+typedef struct poll_context
+{
+  poll_request_t requests[2];
+  uint8_t current;
+  uint8_t next_station;
+  /* link speed: confirmed one and the one under test while probing */
+  uint8_t link_baud;
+  bool link_probing;
+  uint8_t probe_baud;
+  uint8_t probe_answers;
+  uint8_t link_errors;
+  uint32_t last_probe_tick;
+} poll_context_t;
+
+extern hmi_main_screen_t main_screen_data;
+
+static hmi_tile_table_t *const p_tiles = &main_screen_data.tiles;
+static poll_context_t poll_contexts[XGB_NO_CHANNELS];
+
+/* every tile is in one group at most, so there are never more groups */
+static poll_group_t poll_groups[HMI_NO_TILES];
+/* group of each tile and its block in the group, tiles that read the same
+ * device share the block */
+static uint8_t tile_group[HMI_NO_TILES];
+static uint8_t tile_group_block[HMI_NO_TILES];
+/* Page on the screen, its tiles are polled at their own priority and rate */
+static uint8_t visible_page;
+
+/* Any word device answers the probe - NAK (e.g. area out of range) is a
+ * valid frame as well */
+static const xgb_device_t probe_device = {.device_type = XGB_DEV_TYPE_M,
+                                          .size_mark = XGB_DATA_SIZE_WORD,
+                                          .p_address = "0"};
+
+static const uint16_t prio_default_period[POLL_NO_PRIORITIES] = {
+    POLL_PERIOD_HIGH_MS, POLL_PERIOD_NORMAL_MS, POLL_PERIOD_LOW_MS};
+
+static void poll_channel(poll_context_t *p_ctx, uint32_t now);
+static void schedule_wakeup(uint32_t now);
+static void prepare_next_request(poll_context_t *p_ctx, uint32_t now);
+static void start_link_probe(poll_context_t *p_ctx, uint32_t now);
+static void send_probe(poll_context_t *p_ctx);
+static void check_probe_response(poll_context_t *p_ctx);
+static void finish_probe(poll_context_t *p_ctx, xgb_comm_err_t comm_status,
+                         const u_frame *p_frame);
+static void save_link_config(void);
+static void count_link_errors(poll_context_t *p_ctx,
+                              xgb_comm_err_t comm_status);
+static uint8_t collect_stations(const xgb_channel_t *p_channel,
+                                uint8_t *p_stations);
+static uint32_t get_used_stations(uint8_t skip_tile);
+static void start_next_station(poll_context_t *p_ctx, poll_request_t *p_req,
+                               uint32_t now);
+static void start_station(poll_request_t *p_req, uint8_t station_number,
+                          uint32_t now);
+static void schedule_station_now(uint8_t station_number);
+static bool start_write(poll_request_t *p_req);
+static void send_write(poll_request_t *p_req);
+static void finish_write(poll_request_t *p_req, xgb_comm_err_t comm_status);
+static uint8_t select_continuous_writes(uint8_t station_number,
+                                        uint8_t *p_batch);
+static uint8_t count_continuous_run(uint8_t first_tile, uint8_t *p_batch);
+static uint8_t select_single_writes(uint8_t station_number, uint8_t *p_batch);
+static bool is_continuous_write_start(uint8_t tile, uint8_t station_number);
+static bool is_write_fitting(const poll_request_t *p_req, uint8_t no_blocks);
+static void start_read(poll_request_t *p_req, uint32_t now);
+static void send_register(poll_request_t *p_req);
+static void send_read(poll_request_t *p_req);
+static void finish_read(poll_request_t *p_req, xgb_comm_err_t comm_status);
+static void build_poll_groups(void);
+static void fill_poll_group(uint8_t group, uint8_t first_tile);
+static uint8_t find_group_block(const uint8_t *p_block_tiles,
+                                uint8_t no_blocks, uint8_t tile);
+static bool is_same_group(uint8_t first_tile, uint8_t second_tile);
+static bool is_same_read(uint8_t first_tile, uint8_t second_tile);
+static bool is_packed_bit(const hmi_tile_config_t *p_config);
+static uint32_t get_read_address(const hmi_tile_config_t *p_config);
+static uint8_t get_read_size(const hmi_tile_config_t *p_config);
+static uint8_t get_read_bit(const hmi_tile_config_t *p_config);
+static void set_block_device(xgb_device_t *p_device, char *p_text,
+                             uint8_t device_type, uint8_t size_mark,
+                             uint32_t address, uint8_t no_digits);
+static void set_tile_device(xgb_device_t *p_device, char *p_text,
+                            uint8_t tile);
+static uint8_t find_due_group(uint8_t station_number, uint32_t now);
+static uint8_t find_write_group(uint8_t station_number);
+static void select_group_tiles(poll_request_t *p_req, uint8_t group);
+static void keep_first_block(poll_request_t *p_req);
+static bool is_tile_pollable(uint8_t tile);
+static bool is_tile_due(uint8_t tile, uint32_t now);
+static bool is_write_pending(uint8_t tile);
+static bool is_tile_visible(uint8_t tile);
+static poll_priority_t get_tile_priority(uint8_t tile);
+static void reschedule_tile(uint8_t tile, uint32_t now);
+static void check_response(poll_context_t *p_ctx);
+static uint32_t get_response_start(const xgb_channel_t *p_channel);
+static void handle_response(poll_context_t *p_ctx, xgb_comm_err_t comm_status,
+                            const u_frame *p_frame);
+static void dispatch_values(const poll_request_t *p_req);
+static void dispatch_stale(const uint8_t *p_batch, uint8_t batch_size);
+
+/*
+ * Bits are mostly alarms and states - they need to be fresh,
+ * everything else is polled at normal rate. Setpoints change only from the
+ * panel, so they are read back slowly.
+ */
+void poll_set_default_rate(hmi_tile_config_t *p_config)
+{
+  if (READ != p_config->function)
+    {
+      p_config->priority = POLL_PRIO_LOW;
+    }
+  else if (XGB_DATA_SIZE_BIT == p_config->size_mark)
+    {
+      p_config->priority = POLL_PRIO_HIGH;
+    }
+  else
+    {
+      p_config->priority = POLL_PRIO_NORMAL;
+    }
+
+  p_config->poll_period_ms = prio_default_period[p_config->priority];
+
+  return;
+}
+
+void poll_schedule_all_now(void)
+{
+  uint32_t now = HAL_GetTick();
+
+  for (uint8_t i = 0; i < HMI_NO_TILES; i++)
+    {
+      p_tiles->next_poll_tick[i] = now;
+    }
+
+  build_poll_groups();
+
+  // tiles could be reconfigured meanwhile - answer of request that is still
+  // in flight comes when nothing waits for it or it does not echo the next
+  // request, the parser drops it then
+  for (uint8_t i = 0; i < XGB_NO_CHANNELS; i++)
+    {
+      poll_context_t *p_ctx = &poll_contexts[i];
+
+      // link speed and probing state survive, only requests are dropped
+      xgb_channel_cancel(xgb_get_channel(i));
+      memset(p_ctx->requests, 0, sizeof(p_ctx->requests));
+      p_ctx->current = 0;
+      p_ctx->next_station = 0;
+
+      for (uint8_t j = 0; j < 2U; j++)
+        {
+          p_ctx->requests[j].p_channel = xgb_get_channel(i);
+          p_ctx->requests[j].step = POLL_STEP_IDLE;
+        }
+
+      // speed under test was set without a request in flight - back to the
+      // last confirmed one, probing starts over
+      if (true == p_ctx->link_probing)
+        {
+          xgb_channel_set_baud(xgb_get_channel(i), p_ctx->link_baud);
+          start_link_probe(p_ctx, now);
+        }
+    }
+
+  return;
+}
+
+/*
+ * Config of one tile was edited - poll groups follow it and the tile is read
+ * at once. Values of the other tiles and requests in flight stay.
+ */
+void poll_tile_changed(uint8_t tile_number)
+{
+  build_poll_groups();
+  p_tiles->next_poll_tick[tile_number] = HAL_GetTick();
+  xgb_station_release_unused(get_used_stations(NO_TILE_FOUND));
+
+  // monitor slots belong to the new groups - answers of requests in flight
+  // still go to their tiles, but do not touch the slots
+  for (uint8_t i = 0; i < XGB_NO_CHANNELS; i++)
+    {
+      for (uint8_t j = 0; j < 2U; j++)
+        {
+          poll_contexts[i].requests[j].monitor_slot = XGB_MONITOR_NONE;
+        }
+    }
+
+  return;
+}
+
+/*
+ * Statistics (timeout, health, BCC) are kept for XGB_MAX_STATIONS stations.
+ * Tile can take a station that other tiles use already, a new one only
+ * while there is room for it.
+ */
+bool poll_is_station_allowed(uint8_t tile_number, uint8_t station_number)
+{
+  uint32_t used_stations = get_used_stations(tile_number);
+  uint8_t no_stations = 0;
+
+  if (0 != (used_stations & (1UL << station_number)))
+    {
+      return true;
+    }
+
+  for (uint8_t i = 0; i <= XGB_MAX_STATION_NUMBER; i++)
+    {
+      if (0 != (used_stations & (1UL << i)))
+        {
+          no_stations++;
+        }
+    }
+
+  return (no_stations < XGB_MAX_STATIONS);
+}
+
+/*
+ * Tiles of the new page are due at once - values from the background poll
+ * are shown meanwhile
+ */
+void poll_set_visible_page(uint8_t page)
+{
+  uint32_t now = HAL_GetTick();
+  uint8_t first_tile = page * HMI_TILES_PER_PAGE;
+
+  visible_page = page;
+
+  for (uint8_t i = first_tile; i < first_tile + HMI_TILES_PER_PAGE; i++)
+    {
+      p_tiles->next_poll_tick[i] = now;
+    }
+
+  return;
+}
+
+/*
+ * Link speed of each channel from config. New panel has none - channels
+ * start at the default speed and are commissioned by probing as soon as
+ * they have stations.
+ */
+void poll_init_link(void)
+{
+  hmi_link_config_t link_config;
+  bool config_valid = cfg_load_link(&link_config);
+  uint32_t now = HAL_GetTick();
+
+  for (uint8_t i = 0; i < XGB_NO_CHANNELS; i++)
+    {
+      poll_context_t *p_ctx = &poll_contexts[i];
+
+      p_ctx->link_baud = XGB_BAUD_DEFAULT;
+
+      if (true == config_valid && link_config.baud_index[i] < XGB_NO_BAUD_RATES)
+        {
+          p_ctx->link_baud = link_config.baud_index[i];
+        }
+
+      xgb_channel_set_baud(xgb_get_channel(i), p_ctx->link_baud);
+
+      if (false == config_valid)
+        {
+          start_link_probe(p_ctx, now);
+        }
+    }
+
+  return;
+}
+
+/*
+ * Value is sent with the next poll cycle, a newer value of the same tile
+ * overwrites the one that was not sent yet
+ */
+void poll_queue_write(uint8_t tile_number, int32_t value)
+{
+  p_tiles->setpoint[tile_number] = value;
+  p_tiles->flags[tile_number] |= HMI_TILE_WRITE_PENDING;
+
+  return;
+}
+
+/*
+ * Channels run side by side: every call moves each of them as far as it can
+ * without waiting - request waits for its bus, response is taken when
+ * complete
+ */
+void poll_process(void)
+{
+  uint32_t now = HAL_GetTick();
+
+  for (uint8_t i = 0; i < XGB_NO_CHANNELS; i++)
+    {
+      poll_channel(&poll_contexts[i], now);
+    }
+
+  schedule_wakeup(now);
+
+  return;
+}
+
+/*
+ * Main loop sleeps until the next tile is due. Request in flight is checked
+ * every tick for its timeout and bus turnaround, the response itself wakes
+ * the loop right away. Write to a dead station does not keep the loop
+ * awake, it waits for the next probe of the station.
+ */
+static void schedule_wakeup(uint32_t now)
+{
+  uint32_t wake_tick = now + POLL_MAX_SLEEP_MS;
+
+  for (uint8_t i = 0; i < XGB_NO_CHANNELS; i++)
+    {
+      const poll_context_t *p_ctx = &poll_contexts[i];
+
+      if (POLL_STEP_IDLE != p_ctx->requests[p_ctx->current].step ||
+          true == xgb_channel_is_sending(xgb_get_channel(i)))
+        {
+          ev_wake_at(now);
+          return;
+        }
+    }
+
+  for (uint8_t i = 0; i < HMI_NO_TILES; i++)
+    {
+      uint8_t station_number = p_tiles->config[i].station_number;
+
+      if (true == is_write_pending(i) &&
+          true == xgb_station_is_online(station_number))
+        {
+          ev_wake_at(now);
+          return;
+        }
+
+      if (true == is_write_pending(i) &&
+          (int32_t)(xgb_station_get_probe_tick(station_number) - wake_tick) <
+              0)
+        {
+          wake_tick = xgb_station_get_probe_tick(station_number);
+        }
+
+      if (true == is_tile_pollable(i) &&
+          (int32_t)(p_tiles->next_poll_tick[i] - wake_tick) < 0)
+        {
+          wake_tick = p_tiles->next_poll_tick[i];
+        }
+    }
+
+  ev_wake_at(wake_tick);
+
+  return;
+}
+
+static void poll_channel(poll_context_t *p_ctx, uint32_t now)
+{
+  poll_request_t *p_req = &p_ctx->requests[p_ctx->current];
+  poll_request_t *p_next = &p_ctx->requests[p_ctx->current ^ 1U];
+
+  xgb_channel_service(p_req->p_channel);
+
+  if (POLL_STEP_IDLE != p_req->step)
+    {
+      check_response(p_ctx);
+    }
+
+  if (POLL_STEP_IDLE == p_req->step)
+    {
+      // request armed behind the finished one is on the wire already
+      if (POLL_STEP_IDLE != p_next->step)
+        {
+          p_ctx->current ^= 1U;
+        }
+      else if (true == p_ctx->link_probing)
+        {
+          send_probe(p_ctx);
+        }
+      else
+        {
+          start_next_station(p_ctx, p_req, now);
+        }
+    }
+
+  if (false == p_ctx->link_probing)
+    {
+      prepare_next_request(p_ctx, now);
+    }
+
+  return;
+}
+
+/*
+ * Commissioning of the link: speeds are tried from the fastest one down,
+ * the first one with POLL_PROBE_ANSWERS valid answers in a row is taken
+ */
+static void start_link_probe(poll_context_t *p_ctx, uint32_t now)
+{
+  p_ctx->link_probing = true;
+  p_ctx->probe_baud = XGB_NO_BAUD_RATES - 1U;
+  p_ctx->probe_answers = 0;
+  p_ctx->link_errors = 0;
+  p_ctx->last_probe_tick = now;
+
+  return;
+}
+
+/*
+ * Probe goes to the first station of the channel. Channel is idle here, so
+ * its speed can be switched.
+ */
+static void send_probe(poll_context_t *p_ctx)
+{
+  poll_request_t *p_req = &p_ctx->requests[p_ctx->current];
+  uint8_t stations[HMI_NO_TILES];
+
+  // nothing to talk to yet - probing waits for the first tile
+  if (0 == collect_stations(p_req->p_channel, stations))
+    {
+      return;
+    }
+
+  if (p_ctx->probe_baud != xgb_channel_get_baud(p_req->p_channel))
+    {
+      xgb_channel_set_baud(p_req->p_channel, p_ctx->probe_baud);
+    }
+
+  p_req->station_number = stations[0];
+  p_req->step = POLL_STEP_PROBE;
+  p_req->frame_type = XGB_FRAME_READ;
+
+  if (XGB_OK != xgb_read_devices(p_req->p_channel, p_req->station_number,
+                                 &probe_device, 1))
+    {
+      p_req->step = POLL_STEP_IDLE;
+    }
+
+  return;
+}
+
+/*
+ * Fixed timeout - statistics of the station are not spoiled by answers
+ * that never come at a wrong speed
+ */
+static void check_probe_response(poll_context_t *p_ctx)
+{
+  poll_request_t *p_req = &p_ctx->requests[p_ctx->current];
+  const u_frame *p_frame = NULL;
+  xgb_comm_err_t comm_status =
+      xgb_get_response_frame(p_req->p_channel, &p_frame);
+
+  if (XGB_ERR_NO_FRAME == comm_status)
+    {
+      if (true == xgb_channel_is_sending(p_req->p_channel) ||
+          HAL_GetTick() - get_response_start(p_req->p_channel) <=
+              POLL_PROBE_TIMEOUT_MS)
+        {
+          return;
+        }
+
+      comm_status = XGB_ERR_TRANSMIT_TIMEOUT;
+      xgb_channel_response_timeout(p_req->p_channel);
+    }
+
+  finish_probe(p_ctx, comm_status, p_frame);
+
+  return;
+}
+
+/*
+ * Any error at a speed falls back to the next slower one. If no speed
+ * works (PLC off, cable loose), the last confirmed speed stays and probing
+ * is repeated after POLL_LINK_REPROBE_MS of failed requests.
+ */
+static void finish_probe(poll_context_t *p_ctx, xgb_comm_err_t comm_status,
+                         const u_frame *p_frame)
+{
+  poll_request_t *p_req = &p_ctx->requests[p_ctx->current];
+
+  p_req->step = POLL_STEP_IDLE;
+
+  // ACK or NAK with correct layout - garbage of wrong speed never parses
+  if (XGB_OK == comm_status)
+    {
+      comm_status = xgb_parse_read_response(p_frame, p_req->values, 1);
+    }
+
+  if (XGB_OK == comm_status || XGB_ERR_NAK == comm_status)
+    {
+      if (++p_ctx->probe_answers >= POLL_PROBE_ANSWERS)
+        {
+          p_ctx->link_probing = false;
+          p_ctx->link_baud = p_ctx->probe_baud;
+          save_link_config();
+        }
+
+      return;
+    }
+
+  p_ctx->probe_answers = 0;
+
+  if (0 == p_ctx->probe_baud)
+    {
+      p_ctx->link_probing = false;
+      xgb_channel_set_baud(p_req->p_channel, p_ctx->link_baud);
+      return;
+    }
+
+  p_ctx->probe_baud--;
+
+  return;
+}
+
+static void save_link_config(void)
+{
+  hmi_link_config_t link_config;
+
+  for (uint8_t i = 0; i < XGB_NO_CHANNELS; i++)
+    {
+      link_config.baud_index[i] = poll_contexts[i].link_baud;
+    }
+
+  cfg_save_link(&link_config);
+
+  return;
+}
+
+/*
+ * Whole channel failing in a row looks like wrong speed (PLC port was
+ * reconfigured) - probe it again, rarely, a dead PLC fails as well
+ */
+static void count_link_errors(poll_context_t *p_ctx,
+                              xgb_comm_err_t comm_status)
+{
+  uint32_t now = HAL_GetTick();
+
+  if (XGB_ERR_TRANSMIT_TIMEOUT != comm_status && XGB_ERR_BCC != comm_status)
+    {
+      p_ctx->link_errors = 0;
+      return;
+    }
+
+  if (p_ctx->link_errors < POLL_LINK_ERROR_LIMIT)
+    {
+      p_ctx->link_errors++;
+      return;
+    }
+
+  if (now - p_ctx->last_probe_tick >= POLL_LINK_REPROBE_MS)
+    {
+      start_link_probe(p_ctx, now);
+    }
+
+  return;
+}
+
+/*
+ * While the response is coming, the request that follows it is built and
+ * armed. Only requests that do not depend on the response: read of the
+ * station after its write, next station after a read. Monitor registration
+ * is followed by execute or by RSS - that one waits for the answer.
+ */
+static void prepare_next_request(poll_context_t *p_ctx, uint32_t now)
+{
+  poll_request_t *p_req = &p_ctx->requests[p_ctx->current];
+  poll_request_t *p_next = &p_ctx->requests[p_ctx->current ^ 1U];
+
+  if (POLL_STEP_IDLE != p_next->step)
+    {
+      return;
+    }
+
+  if (POLL_STEP_WRITE == p_req->step)
+    {
+      p_next->station_number = p_req->station_number;
+      p_next->station_was_online = p_req->station_was_online;
+      start_read(p_next, now);
+    }
+  else if (POLL_STEP_READ == p_req->step)
+    {
+      start_next_station(p_ctx, p_next, now);
+    }
+
+  return;
+}
+
+/*
+ * Stations of all configured tiles on the channel, each one once, in tile
+ * order
+ */
+static uint8_t collect_stations(const xgb_channel_t *p_channel,
+                                uint8_t *p_stations)
+{
+  uint8_t no_stations = 0;
+
+  for (uint8_t i = 0; i < HMI_NO_TILES; i++)
+    {
+      uint8_t station_number = p_tiles->config[i].station_number;
+      bool known = false;
+
+      if (0 == (p_tiles->flags[i] & HMI_TILE_CONFIGURED) ||
+          p_channel != xgb_channel_for_station(station_number))
+        {
+          continue;
+        }
+
+      for (uint8_t j = 0; j < no_stations; j++)
+        {
+          if (p_stations[j] == station_number)
+            {
+              known = true;
+              break;
+            }
+        }
+
+      if (false == known)
+        {
+          p_stations[no_stations++] = station_number;
+        }
+    }
+
+  return no_stations;
+}
+
+/*
+ * Stations of configured tiles as bit mask (bit n = station n)
+ */
+static uint32_t get_used_stations(uint8_t skip_tile)
+{
+  uint32_t used_stations = 0;
+
+  for (uint8_t i = 0; i < HMI_NO_TILES; i++)
+    {
+      if (skip_tile != i && 0 != (p_tiles->flags[i] & HMI_TILE_CONFIGURED))
+        {
+          used_stations |= 1UL << p_tiles->config[i].station_number;
+        }
+    }
+
+  return used_stations;
+}
+
+/*
+ * Round robin over stations of the channel, stations with nothing due are
+ * skipped at once
+ */
+static void start_next_station(poll_context_t *p_ctx, poll_request_t *p_req,
+                               uint32_t now)
+{
+  uint8_t stations[HMI_NO_TILES];
+  uint8_t no_stations = collect_stations(p_req->p_channel, stations);
+
+  for (uint8_t i = 0; i < no_stations; i++)
+    {
+      uint8_t index = (p_ctx->next_station + i) % no_stations;
+
+      start_station(p_req, stations[index], now);
+
+      if (POLL_STEP_IDLE != p_req->step)
+        {
+          p_ctx->next_station = index + 1U;
+          break;
+        }
+    }
+
+  return;
+}
+
+/*
+ * At most one write frame with the pending setpoints of the station, then
+ * one batched read with its tiles that are due. Nothing is sent if nothing
+ * is due.
+ */
+static void start_station(poll_request_t *p_req, uint8_t station_number,
+                          uint32_t now)
+{
+  p_req->station_number = station_number;
+  p_req->station_was_online = xgb_station_is_online(station_number);
+
+  // writes wait for the station, offline tiles are probed by reads
+  if (true == p_req->station_was_online && true == start_write(p_req))
+    {
+      return;
+    }
+
+  start_read(p_req, now);
+
+  return;
+}
+
+static void schedule_station_now(uint8_t station_number)
+{
+  uint32_t now = HAL_GetTick();
+
+  for (uint8_t i = 0; i < HMI_NO_TILES; i++)
+    {
+      if (station_number == p_tiles->config[i].station_number)
+        {
+          p_tiles->next_poll_tick[i] = now;
+        }
+    }
+
+  return;
+}
+
+/*
+ * Pending setpoints go out as one frame per cycle: run of consecutive
+ * addresses as continuous write (WSB), everything else merged in one
+ * individual write (WSS). Returns false if there is nothing to write.
+ */
+static bool start_write(poll_request_t *p_req)
+{
+  uint8_t station_number = p_req->station_number;
+
+  p_req->continuous_write = true;
+  p_req->batch_size = select_continuous_writes(station_number, p_req->batch);
+
+  if (p_req->batch_size < 2U)
+    {
+      p_req->continuous_write = false;
+      p_req->batch_size = select_single_writes(station_number, p_req->batch);
+    }
+
+  if (0 == p_req->batch_size)
+    {
+      return false;
+    }
+
+  for (uint8_t i = 0; i < p_req->batch_size; i++)
+    {
+      uint8_t tile = p_req->batch[i];
+      const hmi_tile_config_t *p_config = &p_tiles->config[tile];
+
+      set_block_device(&p_req->devices[i], p_req->addresses[i],
+                       p_config->device_type, p_config->size_mark,
+                       p_config->address, HMI_ADDRESS_DIGITS);
+
+      // long data does not fit 16 blocks in a frame, the rest of the
+      // setpoints stays pending for the next cycle
+      if (false == is_write_fitting(p_req, i + 1U))
+        {
+          p_req->batch_size = i;
+          break;
+        }
+
+      p_req->values[i] = p_tiles->setpoint[tile];
+      p_req->tile_block[i] = i;
+      p_req->tile_bit[i] = NO_BIT;
+    }
+
+  p_req->no_blocks = p_req->batch_size;
+
+  p_req->retries = 0;
+  send_write(p_req);
+
+  return true;
+}
+
+static void send_write(poll_request_t *p_req)
+{
+  xgb_comm_err_t comm_status;
+
+  if (true == p_req->continuous_write)
+    {
+      comm_status = xgb_write_continuous(
+          p_req->p_channel, p_req->station_number, p_req->devices,
+          p_req->values, p_req->batch_size);
+    }
+  else
+    {
+      comm_status = xgb_write_devices(p_req->p_channel, p_req->station_number,
+                                      p_req->devices, p_req->values,
+                                      p_req->batch_size);
+    }
+
+  p_req->step = POLL_STEP_WRITE;
+  p_req->frame_type = XGB_FRAME_WRITE;
+  p_req->reply_ms =
+      xgb_channel_wire_time(p_req->p_channel, XGB_ACK_RESPONSE_LENGHT);
+
+  if (XGB_OK != comm_status)
+    {
+      finish_write(p_req, comm_status);
+    }
+
+  return;
+}
+
+/*
+ * Tile shows the setpoint only after ACK. Timeout or corrupted ACK keeps the
+ * write pending for the next cycle, setpoint changed meanwhile as well.
+ */
+static void finish_write(poll_request_t *p_req, xgb_comm_err_t comm_status)
+{
+  uint32_t now = HAL_GetTick();
+
+  p_req->step = POLL_STEP_IDLE;
+
+  // repeating the same setpoint is harmless, so write stays pending also
+  // when only the ACK was corrupted
+  if (XGB_ERR_TRANSMIT_TIMEOUT == comm_status || XGB_ERR_BCC == comm_status)
+    {
+      return;
+    }
+
+  for (uint8_t i = 0; i < p_req->batch_size; i++)
+    {
+      uint8_t tile = p_req->batch[i];
+
+      if (p_tiles->setpoint[tile] == p_req->values[i])
+        {
+          p_tiles->flags[tile] &= ~HMI_TILE_WRITE_PENDING;
+        }
+
+      // read back confirms what PLC really holds
+      reschedule_tile(tile, now);
+
+      if (XGB_OK != comm_status)
+        {
+          p_req->values[i] = NAK_VAL;
+        }
+    }
+
+  dispatch_values(p_req);
+
+  return;
+}
+
+/*
+ * Longest run of pending WRITE_CONT tiles with the same device, size and
+ * consecutive addresses
+ */
+static uint8_t select_continuous_writes(uint8_t station_number,
+                                        uint8_t *p_batch)
+{
+  uint8_t run[XGB_MAX_BLOCKS];
+  uint8_t best_size = 0;
+
+  for (uint8_t i = 0; i < HMI_NO_TILES; i++)
+    {
+      uint8_t run_size;
+
+      if (false == is_continuous_write_start(i, station_number))
+        {
+          continue;
+        }
+
+      run_size = count_continuous_run(i, run);
+
+      if (run_size > best_size)
+        {
+          best_size = run_size;
+          memcpy(p_batch, run, run_size);
+        }
+    }
+
+  return best_size;
+}
+
+static uint8_t count_continuous_run(uint8_t first_tile, uint8_t *p_batch)
+{
+  const hmi_tile_config_t *p_first = &p_tiles->config[first_tile];
+  uint32_t next_address = p_first->address + 1U;
+  uint8_t run_size = 1;
+
+  p_batch[0] = first_tile;
+
+  while (run_size < XGB_MAX_BLOCKS)
+    {
+      uint8_t found_tile = NO_TILE_FOUND;
+
+      for (uint8_t i = 0; i < HMI_NO_TILES; i++)
+        {
+          const hmi_tile_config_t *p_config = &p_tiles->config[i];
+
+          if (true == is_continuous_write_start(i, p_first->station_number) &&
+              p_first->device_type == p_config->device_type &&
+              p_first->size_mark == p_config->size_mark &&
+              next_address == p_config->address)
+            {
+              found_tile = i;
+              break;
+            }
+        }
+
+      if (NO_TILE_FOUND == found_tile)
+        {
+          break;
+        }
+
+      p_batch[run_size++] = found_tile;
+      next_address++;
+    }
+
+  return run_size;
+}
+
+static uint8_t select_single_writes(uint8_t station_number, uint8_t *p_batch)
+{
+  uint8_t batch_size = 0;
+
+  for (uint8_t i = 0; i < HMI_NO_TILES && batch_size < XGB_MAX_BLOCKS; i++)
+    {
+      if (true == is_write_pending(i) &&
+          station_number == p_tiles->config[i].station_number)
+        {
+          p_batch[batch_size++] = i;
+        }
+    }
+
+  return batch_size;
+}
+
+/*
+ * Bit addresses hold the bit number in the last digit, they are never
+ * written continuously
+ */
+static bool is_continuous_write_start(uint8_t tile, uint8_t station_number)
+{
+  const hmi_tile_config_t *p_config = &p_tiles->config[tile];
+
+  return (true == is_write_pending(tile) &&
+          station_number == p_config->station_number &&
+          WRITE_CONT == p_config->function &&
+          XGB_DATA_SIZE_BIT != p_config->size_mark);
+}
+
+static bool is_write_fitting(const poll_request_t *p_req, uint8_t no_blocks)
+{
+  return (true == p_req->continuous_write)
+             ? xgb_write_continuous_fits(p_req->devices, no_blocks)
+             : xgb_write_fits(p_req->devices, no_blocks);
+}
+
+/*
+ * Tiles are grouped once here (after every change of config), in tile
+ * order. Group gets a monitor slot if any is left, registers of its station
+ * are given in the order of groups.
+ */
+static void build_poll_groups(void)
+{
+  uint8_t no_groups = 0;
+
+  xgb_monitor_reset();
+  memset(tile_group, NO_GROUP, sizeof(tile_group));
+
+  for (uint8_t i = 0; i < HMI_NO_TILES; i++)
+    {
+      if (0 != (p_tiles->flags[i] & HMI_TILE_CONFIGURED) &&
+          NO_GROUP == tile_group[i])
+        {
+          fill_poll_group(no_groups++, i);
+        }
+    }
+
+  return;
+}
+
+/*
+ * Tiles of the same station, page and priority join the group of the first
+ * one. Tile with a device that does not fit in the frame (or its response)
+ * any more is left for the next group.
+ */
+static void fill_poll_group(uint8_t group, uint8_t first_tile)
+{
+  poll_group_t *p_group = &poll_groups[group];
+  xgb_device_t devices[XGB_MAX_BLOCKS];
+  char addresses[XGB_MAX_BLOCKS][HMI_ADDRESS_DIGITS + 1U];
+  uint8_t block_tiles[XGB_MAX_BLOCKS];
+
+  p_group->station_number = p_tiles->config[first_tile].station_number;
+  p_group->no_blocks = 0;
+
+  for (uint8_t i = first_tile; i < HMI_NO_TILES; i++)
+    {
+      uint8_t block;
+
+      if (NO_GROUP != tile_group[i] || false == is_same_group(first_tile, i))
+        {
+          continue;
+        }
+
+      block = find_group_block(block_tiles, p_group->no_blocks, i);
+
+      if (block == p_group->no_blocks)
+        {
+          if (block >= XGB_MAX_BLOCKS)
+            {
+              continue;
+            }
+
+          set_tile_device(&devices[block], addresses[block], i);
+
+          if (false == xgb_read_fits(devices, block + 1U))
+            {
+              continue;
+            }
+
+          block_tiles[block] = i;
+          p_group->no_blocks++;
+        }
+
+      tile_group[i] = group;
+      tile_group_block[i] = block;
+    }
+
+  p_group->monitor_slot = xgb_monitor_add(p_group->station_number);
+
+  return;
+}
+
+/*
+ * Block of the group that reads the device of the tile, no_blocks if there
+ * is none yet
+ */
+static uint8_t find_group_block(const uint8_t *p_block_tiles,
+                                uint8_t no_blocks, uint8_t tile)
+{
+  for (uint8_t block = 0; block < no_blocks; block++)
+    {
+      if (true == is_same_read(p_block_tiles[block], tile))
+        {
+          return block;
+        }
+    }
+
+  return no_blocks;
+}
+
+/*
+ * Tiles of a group are due together - their period follows priority, and
+ * the page decides if they are polled in the background
+ */
+static bool is_same_group(uint8_t first_tile, uint8_t second_tile)
+{
+  const hmi_tile_config_t *p_first = &p_tiles->config[first_tile];
+  const hmi_tile_config_t *p_second = &p_tiles->config[second_tile];
+
+  return (0 != (p_tiles->flags[second_tile] & HMI_TILE_CONFIGURED) &&
+          p_first->station_number == p_second->station_number &&
+          p_first->priority == p_second->priority &&
+          first_tile / HMI_TILES_PER_PAGE == second_tile / HMI_TILES_PER_PAGE);
+}
+
+/*
+ * Bit tiles read the word that holds the bit (%MX1005 -> bit 5 of %MW100),
+ * so all lamps of one word cost one block
+ */
+static bool is_same_read(uint8_t first_tile, uint8_t second_tile)
+{
+  const hmi_tile_config_t *p_first = &p_tiles->config[first_tile];
+  const hmi_tile_config_t *p_second = &p_tiles->config[second_tile];
+
+  return (p_first->station_number == p_second->station_number &&
+          p_first->device_type == p_second->device_type &&
+          get_read_size(p_first) == get_read_size(p_second) &&
+          get_read_address(p_first) == get_read_address(p_second));
+}
+
+/*
+ * Bit number is the last digit of the address. PLC takes it as a hex digit
+ * (%MX100F is bit 15), the address is edited and stored in decimal digits,
+ * so only bits 0 - 9 of a word can be set up - split with / 10 and % 10
+ * matches that. Bits of timers and counters are contacts, not bits of
+ * their word (current value), so they are read one by one.
+ */
+static bool is_packed_bit(const hmi_tile_config_t *p_config)
+{
+  return (XGB_DATA_SIZE_BIT == p_config->size_mark &&
+          XGB_DEV_TYPE_T != p_config->device_type &&
+          XGB_DEV_TYPE_C != p_config->device_type);
+}
+
+static uint32_t get_read_address(const hmi_tile_config_t *p_config)
+{
+  return (true == is_packed_bit(p_config)) ? p_config->address / 10U
+                                           : p_config->address;
+}
+
+static uint8_t get_read_size(const hmi_tile_config_t *p_config)
+{
+  return (true == is_packed_bit(p_config)) ? XGB_DATA_SIZE_WORD
+                                           : p_config->size_mark;
+}
+
+static uint8_t get_read_bit(const hmi_tile_config_t *p_config)
+{
+  return (true == is_packed_bit(p_config)) ? p_config->address % 10U
+                                           : NO_BIT;
+}
+
+/*
+ * Address text lives in the request as long as its frame may be sent again,
+ * digits with leading zeros as they were edited
+ */
+static void set_block_device(xgb_device_t *p_device, char *p_text,
+                             uint8_t device_type, uint8_t size_mark,
+                             uint32_t address, uint8_t no_digits)
+{
+  p_text[no_digits] = '\0';
+
+  for (uint8_t i = no_digits; i > 0; i--)
+    {
+      p_text[i - 1U] = (char)('0' + (address % 10U));
+      address /= 10U;
+    }
+
+  p_device->device_type = (xgb_device_type_t)device_type;
+  p_device->size_mark = (xgb_data_size_marking_t)size_mark;
+  p_device->p_address = p_text;
+
+  return;
+}
+
+/*
+ * Device that the tile is read with - word of packed bits has one digit
+ * less
+ */
+static void set_tile_device(xgb_device_t *p_device, char *p_text,
+                            uint8_t tile)
+{
+  const hmi_tile_config_t *p_config = &p_tiles->config[tile];
+  uint8_t no_digits = (true == is_packed_bit(p_config))
+                          ? HMI_ADDRESS_DIGITS - 1U
+                          : HMI_ADDRESS_DIGITS;
+
+  set_block_device(p_device, p_text, p_config->device_type,
+                   get_read_size(p_config), get_read_address(p_config),
+                   no_digits);
+
+  return;
+}
+
+/*
+ * Group with the most overdue tile of the highest priority, tiles of hidden
+ * pages count as low priority
+ */
+static uint8_t find_due_group(uint8_t station_number, uint32_t now)
+{
+  uint8_t found_group = NO_GROUP;
+  poll_priority_t found_priority = POLL_PRIO_LOW;
+  uint32_t max_overdue = 0;
+
+  for (uint8_t i = 0; i < HMI_NO_TILES; i++)
+    {
+      poll_priority_t priority = get_tile_priority(i);
+      uint32_t overdue = now - p_tiles->next_poll_tick[i];
+
+      if (NO_GROUP == tile_group[i] ||
+          station_number != p_tiles->config[i].station_number ||
+          false == is_tile_pollable(i) || false == is_tile_due(i, now))
+        {
+          continue;
+        }
+
+      if (NO_GROUP == found_group || priority < found_priority ||
+          (priority == found_priority && overdue > max_overdue))
+        {
+          found_group = tile_group[i];
+          found_priority = priority;
+          max_overdue = overdue;
+        }
+    }
+
+  return found_group;
+}
+
+static uint8_t find_write_group(uint8_t station_number)
+{
+  for (uint8_t i = 0; i < HMI_NO_TILES; i++)
+    {
+      if (true == is_write_pending(i) &&
+          station_number == p_tiles->config[i].station_number)
+        {
+          return tile_group[i];
+        }
+    }
+
+  return NO_GROUP;
+}
+
+/*
+ * Whole group is read - tiles that are not due yet get the value as well and
+ * are rescheduled with it, so the group stays in step. Devices of tiles
+ * waiting with a write are read too, the group never changes its blocks.
+ */
+static void select_group_tiles(poll_request_t *p_req, uint8_t group)
+{
+  p_req->batch_size = 0;
+  p_req->no_blocks = poll_groups[group].no_blocks;
+
+  for (uint8_t i = 0; i < HMI_NO_TILES; i++)
+    {
+      uint8_t block = tile_group_block[i];
+
+      if (group != tile_group[i])
+        {
+          continue;
+        }
+
+      set_tile_device(&p_req->devices[block], p_req->addresses[block], i);
+
+      if (true == is_tile_pollable(i))
+        {
+          p_req->batch[p_req->batch_size] = i;
+          p_req->tile_block[p_req->batch_size] = block;
+          p_req->tile_bit[p_req->batch_size] =
+              get_read_bit(&p_tiles->config[i]);
+          p_req->batch_size++;
+        }
+    }
+
+  return;
+}
+
+/*
+ * Probe of dead station reads only the first block, the other tiles are
+ * shown as stale at once
+ */
+static void keep_first_block(poll_request_t *p_req)
+{
+  uint8_t batch_size = 0;
+
+  for (uint8_t i = 0; i < p_req->batch_size; i++)
+    {
+      if (0 != p_req->tile_block[i])
+        {
+          dispatch_stale(&p_req->batch[i], 1);
+          continue;
+        }
+
+      p_req->batch[batch_size] = p_req->batch[i];
+      p_req->tile_block[batch_size] = 0;
+      p_req->tile_bit[batch_size] = p_req->tile_bit[i];
+      batch_size++;
+    }
+
+  p_req->batch_size = batch_size;
+  p_req->no_blocks = 1;
+
+  return;
+}
+
+static bool is_tile_pollable(uint8_t tile)
+{
+  // write tiles are read back too, unless a new setpoint waits to be sent
+  return (HMI_TILE_CONFIGURED ==
+          (p_tiles->flags[tile] &
+           (HMI_TILE_CONFIGURED | HMI_TILE_WRITE_PENDING)));
+}
+
+static bool is_tile_due(uint8_t tile, uint32_t now)
+{
+  // signed difference survives tick overflow
+  return ((int32_t)(now - p_tiles->next_poll_tick[tile]) >= 0);
+}
+
+static bool is_write_pending(uint8_t tile)
+{
+  return (0 != (p_tiles->flags[tile] & HMI_TILE_WRITE_PENDING));
+}
+
+static bool is_tile_visible(uint8_t tile)
+{
+  return (visible_page == tile / HMI_TILES_PER_PAGE);
+}
+
+/*
+ * Groups of hidden tiles come after all groups of the shown page, the shown
+ * page is never delayed by them
+ */
+static poll_priority_t get_tile_priority(uint8_t tile)
+{
+  return (true == is_tile_visible(tile))
+             ? (poll_priority_t)p_tiles->config[tile].priority
+             : POLL_PRIO_LOW;
+}
+
+static void reschedule_tile(uint8_t tile, uint32_t now)
+{
+  uint32_t period = p_tiles->config[tile].poll_period_ms;
+
+  if (false == is_tile_visible(tile) && period < POLL_PERIOD_BACKGROUND_MS)
+    {
+      period = POLL_PERIOD_BACKGROUND_MS;
+    }
+
+  p_tiles->next_poll_tick[tile] = now + period;
+
+  return;
+}
+
+/*
+ * One due group of the station is read with one frame. Group is registered
+ * once as PLC monitor (X) and then read with the short execute frame (Y).
+ * Plain RSS is used if PLC rejects the monitor or no register is left.
+ */
+static void start_read(poll_request_t *p_req, uint32_t now)
+{
+  uint8_t station_number = p_req->station_number;
+  uint8_t group = find_due_group(station_number, now);
+
+  p_req->step = POLL_STEP_IDLE;
+
+  // dead station with nothing but writes is probed by their group
+  if (NO_GROUP == group && false == p_req->station_was_online)
+    {
+      group = find_write_group(station_number);
+    }
+
+  if (NO_GROUP == group)
+    {
+      return;
+    }
+
+  select_group_tiles(p_req, group);
+
+  // dead station costs no bus time, only one cheap probe now and then
+  if (false == p_req->station_was_online)
+    {
+      if (false == xgb_station_is_probe_due(station_number, now))
+        {
+          dispatch_stale(p_req->batch, p_req->batch_size);
+          return;
+        }
+
+      keep_first_block(p_req);
+    }
+
+  for (uint8_t i = 0; i < p_req->batch_size; i++)
+    {
+      reschedule_tile(p_req->batch[i], now);
+    }
+
+  p_req->retries = 0;
+  p_req->monitor_state = XGB_MONITOR_FREE;
+  p_req->monitor_slot = XGB_MONITOR_NONE;
+
+  // probe of dead station is plain RSS, it would only spoil monitors
+  if (true == p_req->station_was_online)
+    {
+      p_req->monitor_slot = poll_groups[group].monitor_slot;
+      p_req->monitor_state =
+          xgb_monitor_get(p_req->monitor_slot, &p_req->register_number);
+    }
+
+  if (XGB_MONITOR_UNREGISTERED == p_req->monitor_state)
+    {
+      send_register(p_req);
+    }
+  else
+    {
+      send_read(p_req);
+    }
+
+  return;
+}
+
+static void send_register(poll_request_t *p_req)
+{
+  xgb_comm_err_t comm_status = xgb_register_monitor(
+      p_req->p_channel, p_req->station_number, p_req->register_number,
+      p_req->devices, p_req->no_blocks);
+
+  p_req->step = POLL_STEP_REGISTER;
+  p_req->frame_type = XGB_FRAME_WRITE;
+  p_req->reply_ms =
+      xgb_channel_wire_time(p_req->p_channel, XGB_ACK_RESPONSE_LENGHT);
+
+  if (XGB_OK != comm_status)
+    {
+      finish_read(p_req, comm_status);
+    }
+
+  return;
+}
+
+static void send_read(poll_request_t *p_req)
+{
+  xgb_comm_err_t comm_status;
+
+  if (XGB_MONITOR_REGISTERED == p_req->monitor_state)
+    {
+      comm_status = xgb_execute_monitor(p_req->p_channel, p_req->station_number,
+                                        p_req->register_number);
+    }
+  else
+    {
+      comm_status = xgb_read_devices(p_req->p_channel, p_req->station_number,
+                                     p_req->devices, p_req->no_blocks);
+    }
+
+  p_req->step = POLL_STEP_READ;
+  p_req->frame_type = XGB_FRAME_READ;
+  p_req->reply_ms = xgb_channel_wire_time(
+      p_req->p_channel,
+      xgb_read_response_lenght(p_req->devices, p_req->no_blocks));
+
+  if (XGB_OK != comm_status)
+    {
+      finish_read(p_req, comm_status);
+    }
+
+  return;
+}
+
+/*
+ * Values or error markers go to the tiles, corrupted response keeps
+ * the last good values - tiles are read again next period
+ */
+static void finish_read(poll_request_t *p_req, xgb_comm_err_t comm_status)
+{
+  uint8_t station_number = p_req->station_number;
+
+  p_req->step = POLL_STEP_IDLE;
+
+  if (XGB_ERR_BCC == comm_status)
+    {
+      return;
+    }
+
+  if (XGB_OK != comm_status)
+    {
+      int32_t error_val = NAK_VAL;
+
+      if (false == xgb_station_is_online(station_number))
+        {
+          error_val = STALE_VAL;
+        }
+      else if (XGB_ERR_TRANSMIT_TIMEOUT == comm_status)
+        {
+          error_val = TIMEOUT_VAL;
+        }
+
+      for (uint8_t i = 0; i < p_req->no_blocks; i++)
+        {
+          p_req->values[i] = error_val;
+        }
+    }
+
+  dispatch_values(p_req);
+
+  // station is back - it could be restarted, so monitors are registered
+  // again, and its tiles are refreshed immediately
+  if (false == p_req->station_was_online &&
+      true == xgb_station_is_online(station_number))
+    {
+      xgb_monitor_invalidate_station(station_number);
+      schedule_station_now(station_number);
+    }
+
+  return;
+}
+
+/*
+ * Response timeout of the station runs from the end of transmission or the
+ * last received byte and feeds the round trip statistics. Corrupted
+ * response is still an answer of the station. Responses come in order, the
+ * first complete frame belongs to the current request even if the next one
+ * is on the wire already.
+ */
+static void check_response(poll_context_t *p_ctx)
+{
+  poll_request_t *p_req = &p_ctx->requests[p_ctx->current];
+  const u_frame *p_frame = NULL;
+  xgb_comm_err_t comm_status;
+
+  if (POLL_STEP_PROBE == p_req->step)
+    {
+      check_probe_response(p_ctx);
+      return;
+    }
+
+  comm_status = xgb_get_response_frame(p_req->p_channel, &p_frame);
+
+  if (XGB_ERR_NO_FRAME == comm_status)
+    {
+      if (true == xgb_channel_is_sending(p_req->p_channel) ||
+          HAL_GetTick() - get_response_start(p_req->p_channel) <=
+              xgb_station_get_timeout(p_req->station_number,
+                                      p_req->frame_type, p_req->reply_ms))
+        {
+          return;
+        }
+
+      comm_status = XGB_ERR_TRANSMIT_TIMEOUT;
+      xgb_channel_response_timeout(p_req->p_channel);
+      xgb_station_timeout(p_req->station_number, p_req->frame_type);
+    }
+  else
+    {
+      xgb_station_rtt_sample(p_req->station_number, p_req->frame_type,
+                             xgb_channel_response_time(p_req->p_channel));
+    }
+
+  count_link_errors(p_ctx, comm_status);
+  handle_response(p_ctx, comm_status, p_frame);
+
+  return;
+}
+
+/*
+ * Timeout runs from the end of the request, every byte that comes starts it
+ * again - long response at low speed is not cut in the middle
+ */
+static uint32_t get_response_start(const xgb_channel_t *p_channel)
+{
+  uint32_t sent_tick = xgb_channel_sent_tick(p_channel);
+  uint32_t received_tick = xgb_channel_received_tick(p_channel);
+
+  if ((int32_t)(received_tick - sent_tick) > 0)
+    {
+      return received_tick;
+    }
+
+  return sent_tick;
+}
+
+/*
+ * Follow-up of the response goes to the same slot - unless the next request
+ * is armed already, then it waits for the next cycle
+ */
+static void handle_response(poll_context_t *p_ctx, xgb_comm_err_t comm_status,
+                            const u_frame *p_frame)
+{
+  poll_request_t *p_req = &p_ctx->requests[p_ctx->current];
+  bool next_armed =
+      (POLL_STEP_IDLE != p_ctx->requests[p_ctx->current ^ 1U].step);
+  bool retry = (XGB_ERR_BCC == comm_status && false == next_armed &&
+                p_req->retries < POLL_CORRUPTED_RETRIES);
+
+  // corrupted on the line - ask again at once instead of waiting a period
+  if (true == retry)
+    {
+      p_req->retries++;
+    }
+
+  switch (p_req->step)
+    {
+    case (POLL_STEP_WRITE):
+      {
+        if (XGB_OK == comm_status)
+          {
+            comm_status = xgb_parse_ack_response(p_frame);
+          }
+
+        finish_write(p_req, comm_status);
+
+        if (false == next_armed)
+          {
+            start_read(p_req, HAL_GetTick());
+          }
+
+        break;
+      }
+
+    case (POLL_STEP_REGISTER):
+      {
+        if (true == retry)
+          {
+            send_register(p_req);
+            break;
+          }
+
+        if (XGB_OK == comm_status)
+          {
+            comm_status = xgb_parse_ack_response(p_frame);
+            xgb_monitor_registered(p_req->monitor_slot,
+                                   (XGB_OK == comm_status));
+          }
+
+        if (XGB_OK == comm_status)
+          {
+            p_req->monitor_state = XGB_MONITOR_REGISTERED;
+          }
+
+        // rejected monitor is read by RSS, no answer is station problem
+        if (XGB_OK == comm_status || XGB_ERR_NAK == comm_status)
+          {
+            p_req->retries = 0;
+            send_read(p_req);
+          }
+        else
+          {
+            finish_read(p_req, comm_status);
+          }
+
+        break;
+      }
+
+    case (POLL_STEP_READ):
+      {
+        if (true == retry)
+          {
+            send_read(p_req);
+            break;
+          }
+
+        if (XGB_OK == comm_status)
+          {
+            comm_status = xgb_parse_read_response(p_frame, p_req->values,
+                                                  p_req->no_blocks);
+
+            if (XGB_MONITOR_REGISTERED == p_req->monitor_state &&
+                (XGB_OK == comm_status || XGB_ERR_NAK == comm_status))
+              {
+                xgb_monitor_executed(p_req->monitor_slot,
+                                     (XGB_OK == comm_status));
+              }
+          }
+
+        finish_read(p_req, comm_status);
+        break;
+      }
+
+    default:
+      {
+        p_req->step = POLL_STEP_IDLE;
+        break;
+      }
+    }
+
+  return;
+}
+
+/*
+ * Value of each block goes to all tiles that subscribed to it, bit tiles
+ * get only their bit of the word. Status markers are negative, word
+ * values never are.
+ */
+static void dispatch_values(const poll_request_t *p_req)
+{
+  for (uint8_t i = 0; i < p_req->batch_size; i++)
+    {
+      uint8_t tile = p_req->batch[i];
+      int32_t value = p_req->values[p_req->tile_block[i]];
+
+      if (NO_BIT != p_req->tile_bit[i] && value >= 0)
+        {
+          value = (value >> p_req->tile_bit[i]) & 1;
+        }
+
+      if (0 != (p_tiles->flags[tile] & HMI_TILE_CONFIGURED))
+        {
+          mm_store_tile_value(tile, value);
+        }
+    }
+
+  return;
+}
+
+/*
+ * Tiles of dead station are rescheduled and shown as stale without sending
+ */
+static void dispatch_stale(const uint8_t *p_batch, uint8_t batch_size)
+{
+  uint32_t now = HAL_GetTick();
+
+  for (uint8_t i = 0; i < batch_size; i++)
+    {
+      uint8_t tile = p_batch[i];
+
+      reschedule_tile(tile, now);
+
+      if (0 != (p_tiles->flags[tile] & HMI_TILE_CONFIGURED))
+        {
+          mm_store_tile_value(tile, STALE_VAL);
+        }
+    }
+
+  return;
+}
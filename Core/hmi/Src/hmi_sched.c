@@ -0,0 +1,56 @@
+/*
+ * hmi_sched.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: pawel
+ */
+
+#include "main.h"
+
+#include "hmi_event.h"
+#include "hmi_sched.h"
+
+static void run_task(sched_task_t *p_task);
+
+/*
+ * One pass of the scheduler: sleep till some event comes, then run every
+ * task waiting for it. Tasks run in the order of the table, so the first
+ * one (input) is never queued behind the others for more than their
+ * budgets.
+ */
+void sched_run(sched_task_t *p_tasks, uint8_t no_tasks)
+{
+  uint32_t events = ev_wait();
+
+  for (uint8_t i = 0; i < no_tasks; i++)
+    {
+      if (0 != (events & p_tasks[i].events))
+        {
+          run_task(&p_tasks[i]);
+        }
+    }
+
+  return;
+}
+
+static void run_task(sched_task_t *p_task)
+{
+  uint32_t start_tick = HAL_GetTick();
+  uint32_t run_time;
+
+  p_task->run();
+
+  run_time = HAL_GetTick() - start_tick;
+
+  if (run_time > p_task->worst_ms)
+    {
+      p_task->worst_ms = (uint16_t)run_time;
+    }
+
+  if (run_time > p_task->budget_ms)
+    {
+      p_task->overruns++;
+    }
+
+  return;
+}
@@ -0,0 +1,193 @@
+/*
+ * xgb_codec.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: pawel
+ */
+
+#include "xgb_codec.h"
+
+/* decode table value of characters that are not hex digits */
+#define XX 0xFFU
+
+/* nibble -> ASCII hex character, 16 B instead of 512 B of a byte table -
+ * the code has to fit 30K of flash */
+static const uint8_t encode_table[16] = {'0', '1', '2', '3', '4', '5',
+                                         '6', '7', '8', '9', 'A', 'B',
+                                         'C', 'D', 'E', 'F'};
+
+/* ASCII character -> nibble, both upper and lower case digits are accepted */
+static const uint8_t decode_table[256] = {
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, /* 0x00 */
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, /* 0x10 */
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, /* 0x20 */
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, XX, XX, XX, XX, XX, XX, /* 0x30 */
+    XX, 10, 11, 12, 13, 14, 15, XX, XX, XX, XX, XX, XX, XX, XX, XX, /* 0x40 */
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, /* 0x50 */
+    XX, 10, 11, 12, 13, 14, 15, XX, XX, XX, XX, XX, XX, XX, XX, XX, /* 0x60 */
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, /* 0x70 */
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, /* 0x80 */
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, /* 0x90 */
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, /* 0xA0 */
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, /* 0xB0 */
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, /* 0xC0 */
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, /* 0xD0 */
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, /* 0xE0 */
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, /* 0xF0 */
+};
+
+static bool decode_bytes(const uint8_t *p_src, uint8_t no_bytes,
+                         uint8_t *p_bytes);
+
+uint8_t *xgb_codec_put_byte(uint8_t *p_dest, uint8_t value)
+{
+  p_dest[0] = encode_table[value >> 4];
+  p_dest[1] = encode_table[value & 0x0FU];
+
+  return p_dest + 2;
+}
+
+uint8_t *xgb_codec_put_word(uint8_t *p_dest, uint16_t value)
+{
+  p_dest = xgb_codec_put_byte(p_dest, (uint8_t)(value >> 8));
+
+  return xgb_codec_put_byte(p_dest, (uint8_t)value);
+}
+
+uint8_t *xgb_codec_put_dword(uint8_t *p_dest, uint32_t value)
+{
+  p_dest = xgb_codec_put_word(p_dest, (uint16_t)(value >> 16));
+
+  return xgb_codec_put_word(p_dest, (uint16_t)value);
+}
+
+uint8_t *xgb_codec_put_lword(uint8_t *p_dest, uint64_t value)
+{
+  p_dest = xgb_codec_put_dword(p_dest, (uint32_t)(value >> 32));
+
+  return xgb_codec_put_dword(p_dest, (uint32_t)value);
+}
+
+/*
+ * Data field of device with given size in bytes (1, 2, 4 or 8). LWORD field
+ * is filled with sign extended value.
+ */
+uint8_t *xgb_codec_put_value(uint8_t *p_dest, uint32_t value, uint8_t no_bytes)
+{
+  switch (no_bytes)
+    {
+    case (2):
+      {
+        return xgb_codec_put_word(p_dest, (uint16_t)value);
+      }
+    case (4):
+      {
+        return xgb_codec_put_dword(p_dest, value);
+      }
+    case (8):
+      {
+        return xgb_codec_put_lword(p_dest, (uint64_t)(int64_t)(int32_t)value);
+      }
+    default:
+      {
+        return xgb_codec_put_byte(p_dest, (uint8_t)value);
+      }
+    }
+}
+
+bool xgb_codec_get_byte(const uint8_t *p_src, uint8_t *p_value)
+{
+  return decode_bytes(p_src, 1, p_value);
+}
+
+bool xgb_codec_get_word(const uint8_t *p_src, uint16_t *p_value)
+{
+  uint8_t bytes[2];
+
+  if (false == decode_bytes(p_src, 2, bytes))
+    {
+      return false;
+    }
+
+  *p_value = ((uint16_t)bytes[0] << 8) | bytes[1];
+
+  return true;
+}
+
+bool xgb_codec_get_dword(const uint8_t *p_src, uint32_t *p_value)
+{
+  uint8_t bytes[4];
+
+  if (false == decode_bytes(p_src, 4, bytes))
+    {
+      return false;
+    }
+
+  *p_value = ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) |
+             ((uint32_t)bytes[2] << 8) | bytes[3];
+
+  return true;
+}
+
+bool xgb_codec_get_lword(const uint8_t *p_src, uint64_t *p_value)
+{
+  uint32_t high;
+  uint32_t low;
+
+  if (false == xgb_codec_get_dword(&p_src[0], &high) ||
+      false == xgb_codec_get_dword(&p_src[8], &low))
+    {
+      return false;
+    }
+
+  *p_value = ((uint64_t)high << 32) | low;
+
+  return true;
+}
+
+/*
+ * Data field of device with given size in bytes, LWORD keeps only lower
+ * 32 bits
+ */
+bool xgb_codec_get_value(const uint8_t *p_src, uint8_t no_bytes,
+                         uint32_t *p_value)
+{
+  uint8_t bytes[8];
+  uint32_t value = 0;
+
+  if (no_bytes > sizeof(bytes) || false == decode_bytes(p_src, no_bytes, bytes))
+    {
+      return false;
+    }
+
+  for (uint8_t i = 0; i < no_bytes; i++)
+    {
+      value = (value << 8) | bytes[i];
+    }
+
+  *p_value = value;
+
+  return true;
+}
+
+/*
+ * Invalid characters are collected with OR, so the field is checked once at
+ * the end instead of after every character
+ */
+static bool decode_bytes(const uint8_t *p_src, uint8_t no_bytes,
+                         uint8_t *p_bytes)
+{
+  uint8_t invalid = 0;
+
+  for (uint8_t i = 0; i < no_bytes; i++)
+    {
+      uint8_t high = decode_table[p_src[0]];
+      uint8_t low = decode_table[p_src[1]];
+
+      invalid |= high | low;
+      p_bytes[i] = (uint8_t)((high << 4) | low);
+      p_src += 2;
+    }
+
+  return (0 == (invalid & 0xF0U));
+}
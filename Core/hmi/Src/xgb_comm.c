@@ -7,353 +7,1346 @@
 
 #include "xgb_comm.h"
 
+#include "ctype.h"
 #include "main.h"
+#include "hmi_event.h"
+#include "ringbuffer.h"
+#include "xgb_codec.h"
+#include "xgb_station.h"
 #include "stdio.h"
 #include "string.h"
 
-typedef xgb_comm_err_t (*prep_frame_fun_t)(u_frame *frame,
-                                           const cmd_frame_data *p_frame_data);
+#define RX_BUFFER_SIZE 256U
+/* 'R' -> 'r', command letters of BCC frames are lower case */
+#define LOWER_CASE_BIT 0x20U
+#define NO_BCC_CHARS 2U
+/* ACK/NAK + two station chars */
+#define RESPONSE_STATION_END 3U
+/* station, command and command type (or register number) are echoed from
+ * the request */
+#define RESPONSE_ECHO_END 6U
+/* ENQ|station|X|register no|R|SS|no blocks ... EOT|BCC - longest request
+ * without its blocks */
+#define REQUEST_READ_OVERHEAD 14U
+/* ENQ|station|W|SS|no blocks ... EOT|BCC */
+#define REQUEST_WRITE_OVERHEAD 11U
+/* ENQ|station|W|SB ... no data ... EOT|BCC */
+#define REQUEST_WRITE_CONT_OVERHEAD 11U
+/* ACK|station|R|SS|no blocks ... ETX, response is copied out with NULL */
+#define RESPONSE_READ_OVERHEAD 9U
+/* lenght|%|device type|size mark, address follows */
+#define DEVICE_NAME_OVERHEAD 5U
+/* no data of response block */
+#define RESPONSE_BLOCK_OVERHEAD 2U
+/* start bit, 8 data bits and stop bit */
+#define UART_BITS_PER_BYTE 10U
+/* responses completed by the parser and not taken by the main loop yet */
+#define RX_EVENT_QUEUE_SIZE 4U
 
-typedef enum prep_frame
+extern UART_HandleTypeDef huart1;
+extern UART_HandleTypeDef huart2;
+
+/*
+ * Request frame with its lenght, channel has two of them - one on the wire,
+ * the other one serialized while the response is still coming
+ */
+typedef struct xgb_tx_slot
 {
-  INDIVI_READ = 0,
-  CONT_READ = 1,
-  INDIVI_WRITE = 2,
-  CONT_WRITE = 3
-} prep_frame_ID;
+  uint8_t frame[MAX_FRAME_SIZE];
+  uint16_t lenght;
+} xgb_tx_slot_t;
 
-typedef struct prep_fun_mapper
+/*
+ * Position of the response parser within the frame:
+ * ACK/NAK|station|command|body ... ETX|BCC
+ */
+typedef enum rx_parse_state
 {
-  prep_frame_ID ID;
-  prep_frame_fun_t function;
-} prep_fun_mapper_t;
+  RX_PARSE_HEADER = 0,
+  RX_PARSE_STATION,
+  RX_PARSE_COMMAND,
+  RX_PARSE_BODY,
+  RX_PARSE_BCC
+} rx_parse_state_t;
 
-extern UART_HandleTypeDef huart1;
+/*
+ * Response completed by the parser. Bytes stay in the RX ring buffer: line
+ * noise before the frame, frame from header to ETX, BCC chars after it.
+ */
+typedef struct xgb_rx_event
+{
+  uint16_t noise_lenght;
+  uint16_t frame_lenght;
+  uint16_t tail_lenght;
+  bool bcc_valid;
+} xgb_rx_event_t;
+
+/*
+ * One UART with its DMA channels (linked in the UART handle) and the
+ * stations that are wired to it. Channels have own buffers, so requests on
+ * different channels are in flight at the same time.
+ */
+struct xgb_channel
+{
+  UART_HandleTypeDef *p_huart;
+  uint32_t station_mask;
+  uint8_t baud_index;
+  /* RX runs as permanent circular DMA straight into this buffer */
+  uint8_t rx_buffer[RX_BUFFER_SIZE];
+  Ringbuffer_t rx_ring_buffer;
+  uint16_t rx_dma_position;
+  volatile uint32_t rx_last_activity_tick;
+  /* DMA has overwritten bytes that were not taken yet, nothing is parsed
+   * until the main loop drops what was received */
+  volatile bool rx_overrun;
+  /* position went past the end of the buffer since the last TC event */
+  bool rx_wrapped;
+  /* parser runs on every new byte (interrupt or main loop with interrupts
+   * off), BCC is summed from header to ETX and compared with two hex chars */
+  rx_parse_state_t rx_state;
+  /* frame echoes the header of the request that is on the wire */
+  bool rx_echo_valid;
+  uint16_t rx_noise_lenght;
+  uint16_t rx_frame_lenght;
+  uint8_t rx_bcc;
+  uint8_t rx_bcc_chars[NO_BCC_CHARS];
+  uint8_t rx_bcc_chars_received;
+  bool rx_with_bcc;
+  Ringbuffer_t rx_event_queue;
+  xgb_rx_event_t rx_events[RX_EVENT_QUEUE_SIZE];
+  /* response frame copied out of the ring buffer, valid until next call */
+  u_frame rx_frame;
+  /* end of response queues the armed request right from the parser */
+  volatile bool rx_awaiting_response;
+  volatile uint32_t rx_response_time;
+  /* active slot is queued / on the wire, the other one is built or armed */
+  xgb_tx_slot_t tx_slots[2];
+  volatile uint8_t tx_active;
+  uint8_t tx_bcc;
+  bool tx_use_bcc;
+  /* request did not fit in the frame, it is never sent */
+  bool tx_overflow;
+  volatile bool tx_armed;
+  volatile bool tx_queued;
+  volatile bool tx_busy;
+  volatile uint32_t tx_done_tick;
+};
 
-static xgb_comm_err_t send_frame(const uint8_t *p_frame, uint32_t lenght);
-static xgb_comm_err_t prep_frame(const u_frame *raw_frame,
-                                 u_frame *ready_frame);
+/*
+ * UART and stations of each channel. Channels are set up from it by
+ * xgb_start_receiving - an initializer would put their 1.1 KB buffers into
+ * .data and its copy into flash.
+ */
+typedef struct xgb_channel_setup
+{
+  UART_HandleTypeDef *p_huart;
+  uint32_t station_mask;
+} xgb_channel_setup_t;
+
+static const xgb_channel_setup_t channel_setup[XGB_NO_CHANNELS] = {
+    {.p_huart = &huart1, .station_mask = XGB_CHANNEL1_STATIONS},
+    {.p_huart = &huart2, .station_mask = XGB_CHANNEL2_STATIONS}};
+
+static xgb_channel_t channels[XGB_NO_CHANNELS];
+
+/* Cnet ports go from 1200 to 115200 bps, below 9600 a poll cycle of full
+ * screen takes seconds. Both USART clocks (64 / 32 MHz) divide all of them
+ * with error below 0.2 %. */
+static const uint32_t baud_rates[XGB_NO_BAUD_RATES] = {9600U, 19200U, 38400U,
+                                                       57600U, 115200U};
+
+static void start_receiving(xgb_channel_t *p_channel);
+static xgb_channel_t *get_channel_of_uart(const UART_HandleTypeDef *huart);
+static uint16_t get_dma_position(const xgb_channel_t *p_channel);
+static void receive_up_to(xgb_channel_t *p_channel, uint16_t position);
+static bool parse_received_byte(xgb_channel_t *p_channel, uint8_t byte);
+static void restart_parser(xgb_channel_t *p_channel, uint8_t byte);
+static bool finish_parsed_frame(xgb_channel_t *p_channel, bool bcc_valid);
+static bool is_response_expected(const xgb_channel_t *p_channel);
+static bool is_echo_byte_valid(const xgb_channel_t *p_channel, uint8_t byte);
+static void reset_parser(xgb_channel_t *p_channel);
+static void drop_received(xgb_channel_t *p_channel);
+static void drop_line_noise(xgb_channel_t *p_channel);
+static void fire_armed_request(xgb_channel_t *p_channel);
+static void release_armed_request(xgb_channel_t *p_channel);
+static void start_transmit(xgb_channel_t *p_channel);
+static void send_if_bus_free(xgb_channel_t *p_channel);
+static xgb_tx_slot_t *tx_build_slot(xgb_channel_t *p_channel);
+static uint8_t data_marking_to_size(xgb_data_size_marking_t data_size);
+static bool is_response_header(uint8_t byte);
+static uint16_t get_device_name_lenght(const xgb_device_t *p_device);
+static void tx_start(xgb_channel_t *p_channel, uint8_t station_number,
+                     uint8_t command);
+static void tx_put_char(xgb_channel_t *p_channel, uint8_t character);
+static void tx_put_hex(xgb_channel_t *p_channel, uint32_t value,
+                       uint8_t no_bytes);
+static void tx_put_device_blocks(xgb_channel_t *p_channel,
+                                 const xgb_device_t *p_devices,
+                                 uint8_t no_of_devices);
+static void tx_put_device_name(xgb_channel_t *p_channel,
+                               const xgb_device_t *p_device);
+static xgb_comm_err_t tx_finish_and_send(xgb_channel_t *p_channel);
+
+/*
+ * Read up to XGB_MAX_BLOCKS devices with one individual read (RSS) frame:
+ * ENQ|station|R|SS|no blocks|(lenght|device name) x blocks|EOT
+ */
+xgb_comm_err_t xgb_read_devices(xgb_channel_t *p_channel,
+                                uint8_t station_number,
+                                const xgb_device_t *p_devices,
+                                uint8_t no_of_devices)
+{
+  if (0 == no_of_devices || no_of_devices > XGB_MAX_BLOCKS ||
+      false == xgb_read_fits(p_devices, no_of_devices))
+    {
+      return XGB_ERR_FRAME;
+    }
 
-static xgb_comm_err_t prep_indivi_read_frame(u_frame *frame,
-                                             const cmd_frame_data *params);
-static xgb_comm_err_t prep_cont_read_frame(u_frame *frame,
-                                           const cmd_frame_data *params);
-static xgb_comm_err_t prep_indivi_write_frame(u_frame *frame,
-                                              const cmd_frame_data *params);
-static xgb_comm_err_t prep_cont_write_frame(u_frame *frame,
-                                            const cmd_frame_data *params);
+  tx_start(p_channel, station_number, 'R');
+  tx_put_char(p_channel, 'S');
+  tx_put_char(p_channel, 'S');
+  tx_put_device_blocks(p_channel, p_devices, no_of_devices);
 
-static xgb_comm_err_t send_specific_cmd(const cmd_frame_data *p_frame_data,
-                                        prep_frame_ID ID);
+  return tx_finish_and_send(p_channel);
+}
 
-static uint8_t data_marking_to_size(xgb_data_size_marking_t data_size);
+/*
+ * Write up to XGB_MAX_BLOCKS devices with one individual write (WSS) frame:
+ * ENQ|station|W|SS|no blocks|(lenght|device name|data) x blocks|EOT
+ */
+xgb_comm_err_t xgb_write_devices(xgb_channel_t *p_channel,
+                                 uint8_t station_number,
+                                 const xgb_device_t *p_devices,
+                                 const int32_t *p_values,
+                                 uint8_t no_of_devices)
+{
+  if (0 == no_of_devices || no_of_devices > XGB_MAX_BLOCKS ||
+      false == xgb_write_fits(p_devices, no_of_devices))
+    {
+      return XGB_ERR_FRAME;
+    }
+
+  tx_start(p_channel, station_number, 'W');
+  tx_put_char(p_channel, 'S');
+  tx_put_char(p_channel, 'S');
+  tx_put_hex(p_channel, no_of_devices, 1);
+
+  for (uint8_t i = 0; i < no_of_devices; i++)
+    {
+      tx_put_device_name(p_channel, &p_devices[i]);
+      tx_put_hex(p_channel, (uint32_t)p_values[i],
+                 data_marking_to_size(p_devices[i].size_mark));
+    }
+
+  return tx_finish_and_send(p_channel);
+}
+
+/*
+ * Write consecutive devices starting from the first one with continuous
+ * write (WSB) frame:
+ * ENQ|station|W|SB|lenght|device name|no data|data|EOT
+ */
+xgb_comm_err_t xgb_write_continuous(xgb_channel_t *p_channel,
+                                    uint8_t station_number,
+                                    const xgb_device_t *p_first_device,
+                                    const int32_t *p_values,
+                                    uint8_t no_of_data)
+{
+  uint8_t data_size = data_marking_to_size(p_first_device->size_mark);
+
+  if (0 == no_of_data || no_of_data > XGB_MAX_BLOCKS ||
+      XGB_DATA_SIZE_BIT == p_first_device->size_mark ||
+      false == xgb_write_continuous_fits(p_first_device, no_of_data))
+    {
+      return XGB_ERR_FRAME;
+    }
+
+  tx_start(p_channel, station_number, 'W');
+  tx_put_char(p_channel, 'S');
+  tx_put_char(p_channel, 'B');
+  tx_put_device_name(p_channel, p_first_device);
+  tx_put_hex(p_channel, no_of_data, 1);
+
+  for (uint8_t i = 0; i < no_of_data; i++)
+    {
+      tx_put_hex(p_channel, (uint32_t)p_values[i], data_size);
+    }
+
+  return tx_finish_and_send(p_channel);
+}
+
+/*
+ * Register individual read of devices in PLC monitor register (00 - 1F):
+ * ENQ|station|X|register no|R|SS|no blocks|(lenght|device name) x blocks|EOT
+ * Response is ACK|station|X|register no|ETX
+ */
+xgb_comm_err_t xgb_register_monitor(xgb_channel_t *p_channel,
+                                    uint8_t station_number,
+                                    uint8_t register_number,
+                                    const xgb_device_t *p_devices,
+                                    uint8_t no_of_devices)
+{
+  if (0 == no_of_devices || no_of_devices > XGB_MAX_BLOCKS ||
+      register_number > XGB_MAX_MONITOR_REGISTER ||
+      false == xgb_read_fits(p_devices, no_of_devices))
+    {
+      return XGB_ERR_FRAME;
+    }
 
-xgb_comm_err_t xgb_read_single_device(xgb_device_type_t type,
-                                      xgb_data_size_marking_t size_mark,
-                                      const char *address)
+  tx_start(p_channel, station_number, 'X');
+  tx_put_hex(p_channel, register_number, 1);
+  tx_put_char(p_channel, 'R');
+  tx_put_char(p_channel, 'S');
+  tx_put_char(p_channel, 'S');
+  tx_put_device_blocks(p_channel, p_devices, no_of_devices);
+
+  return tx_finish_and_send(p_channel);
+}
+
+/*
+ * Execute registered monitor: ENQ|station|Y|register no|EOT
+ * Response has the same layout as RSS response, register number is in place
+ * of command type
+ */
+xgb_comm_err_t xgb_execute_monitor(xgb_channel_t *p_channel,
+                                   uint8_t station_number,
+                                   uint8_t register_number)
+{
+  if (register_number > XGB_MAX_MONITOR_REGISTER)
+    {
+      return XGB_ERR_FRAME;
+    }
+
+  tx_start(p_channel, station_number, 'Y');
+  tx_put_hex(p_channel, register_number, 1);
+
+  return tx_finish_and_send(p_channel);
+}
+
+/*
+ * Both the read request (RSS or monitor register) and its response have to
+ * fit in a frame - LWORD blocks make the response long, long addresses the
+ * request
+ */
+bool xgb_read_fits(const xgb_device_t *p_devices, uint8_t no_of_devices)
 {
-  cmd_frame_data frame = {0};
-  xgb_comm_err_t comm_status = XGB_OK;
+  uint16_t request_lenght = REQUEST_READ_OVERHEAD;
+  uint16_t response_lenght =
+      xgb_read_response_lenght(p_devices, no_of_devices) - NO_BCC_CHARS;
+
+  for (uint8_t i = 0; i < no_of_devices; i++)
+    {
+      request_lenght += get_device_name_lenght(&p_devices[i]);
+    }
+
+  return (request_lenght <= MAX_FRAME_SIZE &&
+          response_lenght < MAX_FRAME_SIZE);
+}
+
+/*
+ * Longest response to the read (RSS or monitor execute) with BCC - it sets
+ * how long the response takes on the wire
+ */
+uint16_t xgb_read_response_lenght(const xgb_device_t *p_devices,
+                                  uint8_t no_of_devices)
+{
+  uint16_t response_lenght = RESPONSE_READ_OVERHEAD + NO_BCC_CHARS;
+
+  for (uint8_t i = 0; i < no_of_devices; i++)
+    {
+      response_lenght += RESPONSE_BLOCK_OVERHEAD +
+                         2U * data_marking_to_size(p_devices[i].size_mark);
+    }
+
+  return response_lenght;
+}
 
-  frame.ind_read.data_size = size_mark;
-  frame.ind_read.device_type = type;
-  frame.ind_read.no_of_blocks = 1;
-  frame.ind_read.p_device_address = address;
-  frame.ind_read.station_number = STATION_NUMBER;
+/*
+ * Individual write carries name and data of every block
+ */
+bool xgb_write_fits(const xgb_device_t *p_devices, uint8_t no_of_devices)
+{
+  uint16_t request_lenght = REQUEST_WRITE_OVERHEAD;
 
-  comm_status = send_specific_cmd(&frame, INDIVI_READ);
+  for (uint8_t i = 0; i < no_of_devices; i++)
+    {
+      request_lenght += get_device_name_lenght(&p_devices[i]) +
+                        2U * data_marking_to_size(p_devices[i].size_mark);
+    }
 
-  return comm_status;
+  return (request_lenght <= MAX_FRAME_SIZE);
 }
 
-static xgb_comm_err_t send_frame(const uint8_t *p_frame, uint32_t lenght)
+/*
+ * Continuous write has one name, data of all devices follows it
+ */
+bool xgb_write_continuous_fits(const xgb_device_t *p_first_device,
+                               uint8_t no_of_data)
 {
-  xgb_comm_err_t comm_status = XGB_OK;
+  uint16_t request_lenght =
+      REQUEST_WRITE_CONT_OVERHEAD + get_device_name_lenght(p_first_device) +
+      2U * no_of_data * data_marking_to_size(p_first_device->size_mark);
 
-  if ((HAL_UART_Transmit(&huart1, (uint8_t *)p_frame, lenght, 1000) != HAL_OK))
+  return (request_lenght <= MAX_FRAME_SIZE);
+}
+
+/*
+ * Responses without data (write, monitor register) - only ACK / NAK matters
+ */
+xgb_comm_err_t xgb_parse_ack_response(const u_frame *p_frame)
+{
+  if (XGB_CC_NAK == p_frame->nak_frame.header_nak)
     {
-      comm_status = XGB_ERR_TRANSMIT_TIMEOUT;
+      return XGB_ERR_NAK;
     }
 
-  return comm_status;
+  return XGB_OK;
 }
 
 /*
- * Delete all the empty spaces between parts of frame and add NULL at the end
+ * Decode RSS (or monitor execute) response, values are returned in the order
+ * of requested blocks:
+ * ACK|station|R|SS|no blocks|(no data|data) x blocks|ETX
+ * ACK|station|Y|register no|no blocks|(no data|data) x blocks|ETX
  */
-static xgb_comm_err_t prep_frame(const u_frame *raw_frame, u_frame *ready_frame)
+xgb_comm_err_t xgb_parse_read_response(const u_frame *p_frame,
+                                       int32_t *p_values,
+                                       uint8_t no_of_devices)
 {
-  uint8_t j = 0;
-  xgb_comm_err_t comm_status = XGB_ERR_EOT_MISSING;
+  const uint8_t *p_read = p_frame->frame_bytes;
+  const uint8_t *p_end =
+      p_read + strlen((const char *)p_frame->frame_bytes) - 1;
+  uint8_t no_blocks;
+
+  if (XGB_CC_NAK == p_frame->nak_frame.header_nak)
+    {
+      return XGB_ERR_NAK;
+    }
+
+  if (false == xgb_codec_get_byte(p_frame->ack_frame.no_blocks, &no_blocks) ||
+      no_blocks != no_of_devices)
+    {
+      return XGB_ERR_FRAME;
+    }
+
+  p_read = p_frame->ack_frame.no_data;
+
+  for (uint8_t i = 0; i < no_of_devices; i++)
+    {
+      uint8_t no_data;
+      uint32_t value = 0;
+
+      if (p_read + 2 > p_end)
+        {
+          return XGB_ERR_FRAME;
+        }
+
+      if (false == xgb_codec_get_byte(p_read, &no_data))
+        {
+          return XGB_ERR_FRAME;
+        }
+
+      p_read += 2;
 
-  // go trough array and if cell is not empty
-  // rewrite it to ready frame
-  for (uint16_t i = 0; i < MAX_FRAME_SIZE; i++)
+      // data is sent MSB first, LWORD keeps only lower 32 bits
+      if (p_read + (2 * no_data) > p_end ||
+          false == xgb_codec_get_value(p_read, no_data, &value))
+        {
+          return XGB_ERR_FRAME;
+        }
+
+      p_read += 2 * no_data;
+      p_values[i] = (int32_t)value;
+    }
+
+  return XGB_OK;
+}
+
+/*
+ * Stations 00 - 1F are split between channels by their station masks
+ */
+xgb_channel_t *xgb_channel_for_station(uint8_t station_number)
+{
+  for (uint8_t i = 0; i < XGB_NO_CHANNELS; i++)
     {
-      if (0 != raw_frame->frame_bytes[i])
+      if (0 != (channels[i].station_mask & (1UL << station_number)))
         {
-          ready_frame->frame_bytes[j] = raw_frame->frame_bytes[i];
+          return &channels[i];
+        }
+    }
+
+  return &channels[0];
+}
+
+xgb_channel_t *xgb_get_channel(uint8_t channel_index)
+{
+  return &channels[channel_index];
+}
+
+/*
+ * UART is stopped and set up again with the new speed, everything that was
+ * queued or received is dropped. Call it only when no request is pending.
+ */
+void xgb_channel_set_baud(xgb_channel_t *p_channel, uint8_t baud_index)
+{
+  if (baud_index >= XGB_NO_BAUD_RATES)
+    {
+      return;
+    }
+
+  HAL_UART_Abort(p_channel->p_huart);
+
+  p_channel->baud_index = baud_index;
+  p_channel->p_huart->Init.BaudRate = baud_rates[baud_index];
+
+  if (HAL_OK != HAL_UART_Init(p_channel->p_huart))
+    {
+      Error_Handler();
+    }
+
+  p_channel->tx_armed = false;
+  p_channel->tx_queued = false;
+  p_channel->tx_busy = false;
+  p_channel->rx_awaiting_response = false;
+  start_receiving(p_channel);
+
+  return;
+}
+
+uint8_t xgb_channel_get_baud(const xgb_channel_t *p_channel)
+{
+  return p_channel->baud_index;
+}
+
+/*
+ * Time of no_bytes on the wire at the speed of the channel, rounded up
+ */
+uint32_t xgb_channel_wire_time(const xgb_channel_t *p_channel,
+                               uint16_t no_bytes)
+{
+  uint32_t baud_rate = baud_rates[p_channel->baud_index];
+
+  return (((uint32_t)no_bytes * UART_BITS_PER_BYTE * 1000U) + baud_rate -
+          1U) /
+         baud_rate;
+}
+
+/*
+ * Arm RX of all channels once as circular DMA into their ring buffers.
+ * Idle line and half/full transfer events only move the write index, so no
+ * byte is lost between requests. Call it before any other function of the
+ * module.
+ */
+void xgb_start_receiving(void)
+{
+  for (uint8_t i = 0; i < XGB_NO_CHANNELS; i++)
+    {
+      channels[i].p_huart = channel_setup[i].p_huart;
+      channels[i].station_mask = channel_setup[i].station_mask;
+      channels[i].baud_index = XGB_BAUD_DEFAULT;
+      channels[i].tx_armed = false;
+      channels[i].tx_queued = false;
+      channels[i].tx_busy = false;
+      channels[i].rx_awaiting_response = false;
+      start_receiving(&channels[i]);
+    }
+
+  return;
+}
+
+/*
+ * Drop everything that was received so far (e.g. late response after timeout)
+ */
+void xgb_flush_received(xgb_channel_t *p_channel)
+{
+  __disable_irq();
+  drop_received(p_channel);
+  __enable_irq();
+
+  return;
+}
+
+/*
+ * Start the queued request with TX DMA as soon as the bus turnaround time
+ * after the last received byte has passed. Call it from the main loop.
+ * Request armed behind a response is queued by the interrupt that sees the
+ * end of the response and sent by xgb_tick, the main loop may sleep.
+ */
+void xgb_channel_service(xgb_channel_t *p_channel)
+{
+  // bytes that DMA has stored already are parsed now, end of response does
+  // not wait for the idle line interrupt
+  __disable_irq();
+
+  if (true == p_channel->rx_overrun)
+    {
+      drop_received(p_channel);
+    }
+
+  receive_up_to(p_channel, get_dma_position(p_channel));
+  __enable_irq();
+
+  send_if_bus_free(p_channel);
+
+  return;
+}
+
+/*
+ * Called from SysTick every millisecond - request queued behind the
+ * response leaves the first tick after the bus turnaround
+ */
+void xgb_tick(void)
+{
+  for (uint8_t i = 0; i < XGB_NO_CHANNELS; i++)
+    {
+      send_if_bus_free(&channels[i]);
+    }
+
+  return;
+}
+
+/*
+ * No response in time - armed request goes out the usual way after bus
+ * turnaround, late response bytes are dropped
+ */
+void xgb_channel_response_timeout(xgb_channel_t *p_channel)
+{
+  __disable_irq();
+
+  p_channel->rx_awaiting_response = false;
+
+  __enable_irq();
+
+  xgb_flush_received(p_channel);
+  release_armed_request(p_channel);
+
+  return;
+}
+
+/*
+ * Drop requests that were not sent yet together with received bytes
+ */
+void xgb_channel_cancel(xgb_channel_t *p_channel)
+{
+  __disable_irq();
+
+  p_channel->tx_armed = false;
+  p_channel->tx_queued = false;
+  p_channel->rx_awaiting_response = false;
+
+  __enable_irq();
+
+  xgb_flush_received(p_channel);
+
+  return;
+}
+
+/*
+ * Time from the end of request to the end of the last complete response
+ */
+uint32_t xgb_channel_response_time(const xgb_channel_t *p_channel)
+{
+  return p_channel->rx_response_time;
+}
+
+/*
+ * Request is waiting for the bus or still on the wire - response timeout
+ * starts only after that. Armed request is not on the bus yet.
+ */
+bool xgb_channel_is_sending(const xgb_channel_t *p_channel)
+{
+  return (true == p_channel->tx_queued || true == p_channel->tx_busy);
+}
+
+bool xgb_channel_is_armed(const xgb_channel_t *p_channel)
+{
+  return p_channel->tx_armed;
+}
+
+uint32_t xgb_channel_sent_tick(const xgb_channel_t *p_channel)
+{
+  return p_channel->tx_done_tick;
+}
+
+/*
+ * Tick of the last byte that came from the bus (response or noise)
+ */
+uint32_t xgb_channel_received_tick(const xgb_channel_t *p_channel)
+{
+  return p_channel->rx_last_activity_tick;
+}
 
-          if (XGB_CC_EOT == raw_frame->frame_bytes[i]) // if its EOT
+/*
+ * Take the response completed by the parser - the frame is copied out of
+ * the ring buffer only now, parsing was done while the bytes arrived.
+ * Returns XGB_ERR_NO_FRAME until a whole frame is received, XGB_ERR_BCC if
+ * the frame was corrupted on the line.
+ */
+xgb_comm_err_t xgb_get_response_frame(xgb_channel_t *p_channel,
+                                      const u_frame **pp_frame)
+{
+  xgb_rx_event_t event;
+
+  drop_line_noise(p_channel);
+
+  if (RB_OK != RB_Read(&p_channel->rx_event_queue, &event))
+    {
+      return XGB_ERR_NO_FRAME;
+    }
+
+  RB_Consume(&p_channel->rx_ring_buffer, event.noise_lenght);
+  RB_ReadSpan(&p_channel->rx_ring_buffer, p_channel->rx_frame.frame_bytes,
+              event.frame_lenght);
+  RB_Consume(&p_channel->rx_ring_buffer, event.tail_lenght);
+
+  // DMA ran over the frame while it was copied - the request times out
+  if (true == p_channel->rx_overrun)
+    {
+      return XGB_ERR_NO_FRAME;
+    }
+
+  // finish the message with NULL to create a string
+  p_channel->rx_frame.frame_bytes[event.frame_lenght] = 0;
+
+  release_armed_request(p_channel);
+  *pp_frame = &p_channel->rx_frame;
+
+  return (true == event.bcc_valid) ? XGB_OK : XGB_ERR_BCC;
+}
+
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
+{
+  xgb_channel_t *p_channel = get_channel_of_uart(huart);
+
+  if (NULL != p_channel)
+    {
+      // bytes are already in place - only parse and publish the new ones.
+      // Size is stale for HT and TC, the DMA may be further already.
+      receive_up_to(p_channel, get_dma_position(p_channel));
+
+      // Size is the whole buffer only for TC (idle line at position 0 is not
+      // reported). TC without a wrap of the position since the last one -
+      // DMA went round the whole buffer while the interrupt was held off.
+      if (RX_BUFFER_SIZE == Size)
+        {
+          if (false == p_channel->rx_wrapped)
             {
-              // finish the message with NULL to create a string
-              ready_frame->frame_bytes[j + 1] = 0; // NULL
-              comm_status = XGB_OK;
+              p_channel->rx_overrun = true;
             }
 
-          j++;
+          p_channel->rx_wrapped = false;
+        }
+
+      ev_post(EV_COMM);
+    }
+
+  return;
+}
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+  xgb_channel_t *p_channel = get_channel_of_uart(huart);
+
+  // transmission complete - last stop bit is out, response can come now
+  if (NULL != p_channel)
+    {
+      p_channel->tx_done_tick = HAL_GetTick();
+      p_channel->tx_busy = false;
+      ev_post(EV_COMM);
+    }
+
+  return;
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+  xgb_channel_t *p_channel = get_channel_of_uart(huart);
+
+  // noise / overrun aborts the DMA reception - arm it again, request that
+  // was on the wire ends as timeout
+  if (NULL != p_channel)
+    {
+      if (true == p_channel->tx_busy)
+        {
+          p_channel->tx_done_tick = HAL_GetTick();
+          p_channel->tx_busy = false;
+        }
+
+      start_receiving(p_channel);
+      ev_post(EV_COMM);
+    }
+
+  return;
+}
+
+static void start_receiving(xgb_channel_t *p_channel)
+{
+  RB_Init(&p_channel->rx_ring_buffer, p_channel->rx_buffer, sizeof(uint8_t),
+          RX_BUFFER_SIZE);
+  RB_Init(&p_channel->rx_event_queue, p_channel->rx_events,
+          sizeof(xgb_rx_event_t), RX_EVENT_QUEUE_SIZE);
+  p_channel->rx_dma_position = 0;
+  p_channel->rx_overrun = false;
+  p_channel->rx_wrapped = false;
+  reset_parser(p_channel);
+
+  HAL_UARTEx_ReceiveToIdle_DMA(p_channel->p_huart, p_channel->rx_buffer,
+                               RX_BUFFER_SIZE);
+  return;
+}
+
+static xgb_channel_t *get_channel_of_uart(const UART_HandleTypeDef *huart)
+{
+  for (uint8_t i = 0; i < XGB_NO_CHANNELS; i++)
+    {
+      if (huart == channels[i].p_huart)
+        {
+          return &channels[i];
         }
     }
 
-  return comm_status;
-}
+  return NULL;
+}
 
-static xgb_comm_err_t prep_indivi_read_frame(u_frame *destination,
-                                             const cmd_frame_data *params)
+static uint16_t get_dma_position(const xgb_channel_t *p_channel)
 {
-  u_frame temp_frame = {0};
-  xgb_comm_err_t comm_status = XGB_OK;
+  return (uint16_t)(RX_BUFFER_SIZE -
+                    __HAL_DMA_GET_COUNTER(p_channel->p_huart->hdmarx)) %
+         RX_BUFFER_SIZE;
+}
 
-  temp_frame.ind_read_frame.header_enq = XGB_CC_ENQ;
+/*
+ * Publish bytes from the last position up to the DMA position in the ring
+ * buffer and feed them to the parser. Runs in the interrupt or in the main
+ * loop with interrupts off. Only the response of the request on the wire
+ * ends here, late frames are line noise for the parser. Bytes that do not
+ * fit in the free space have overwritten unread ones - the overrun is left
+ * to the main loop, the consumer may be copying a frame right now.
+ */
+static void receive_up_to(xgb_channel_t *p_channel, uint16_t position)
+{
+  bool response_end = false;
+  uint16_t no_bytes =
+      (uint16_t)(position - p_channel->rx_dma_position) % RX_BUFFER_SIZE;
 
-  // station number
-  temp_frame.ind_read_frame.station_number[0] =
-      (params->ind_read.station_number / 16) + '0';
-  temp_frame.ind_read_frame.station_number[1] =
-      (params->ind_read.station_number % 16) + '0';
+  if (0 == no_bytes)
+    {
+      return;
+    }
 
-  // command
-  temp_frame.ind_read_frame.command = 'R';
+  if (position < p_channel->rx_dma_position)
+    {
+      p_channel->rx_wrapped = true;
+    }
 
-  // command type
-  temp_frame.ind_read_frame.command_type[0] = 'S';
-  temp_frame.ind_read_frame.command_type[1] = 'S';
+  if (true == p_channel->rx_overrun ||
+      RB_OK != RB_Commit(&p_channel->rx_ring_buffer, no_bytes))
+    {
+      p_channel->rx_overrun = true;
+      p_channel->rx_dma_position = position;
+      p_channel->rx_last_activity_tick = HAL_GetTick();
+      return;
+    }
 
-  // no blocks
-  temp_frame.ind_read_frame.no_blocks[0] =
-      (params->ind_read.no_of_blocks / 16) + '0';
-  temp_frame.ind_read_frame.no_blocks[1] =
-      (params->ind_read.no_of_blocks % 16) + '0';
+  for (uint16_t i = p_channel->rx_dma_position; i != position;
+       i = (i + 1U) % RX_BUFFER_SIZE)
+    {
+      if (true == parse_received_byte(p_channel, p_channel->rx_buffer[i]))
+        {
+          response_end = true;
+        }
+    }
 
-  // device lenght %MW <- this is 3 chars and then we add lenght of address
-  // %MW100 = 3 + strlen("100") = 6
-  temp_frame.ind_read_frame.device_lenght[0] =
-      ((3 + strlen(params->ind_read.p_device_address)) / 16) + '0';
-  temp_frame.ind_read_frame.device_lenght[1] =
-      ((3 + strlen(params->ind_read.p_device_address)) % 16) + '0';
+  p_channel->rx_dma_position = position;
+  p_channel->rx_last_activity_tick = HAL_GetTick();
 
-  // prepare device name
-  temp_frame.ind_read_frame.device_name[0] = '%';
-  temp_frame.ind_read_frame.device_name[1] =
-      params->ind_read.device_type; // device memory group (P,M,L etc.)
-  temp_frame.ind_read_frame.device_name[2] = params->ind_read.data_size;
-  strcpy((char *restrict)(&temp_frame.ind_read_frame.device_name[3]),
-         (const char *)params->ind_read.p_device_address);
+  if (true == response_end)
+    {
+      p_channel->rx_awaiting_response = false;
+      p_channel->rx_response_time = HAL_GetTick() - p_channel->tx_done_tick;
 
-  temp_frame.ind_read_frame.tail_eot = XGB_CC_EOT;
+      // next request is ready, it leaves after the bus turnaround
+      fire_armed_request(p_channel);
+    }
 
-  // prepare message
-  comm_status = prep_frame(&temp_frame, destination);
-  return comm_status;
+  return;
 }
 
-static xgb_comm_err_t prep_indivi_write_frame(u_frame *destination,
-                                              const cmd_frame_data *params)
+/*
+ * One step of the response state machine, returns true on the last byte of
+ * the awaited response. Station answers in the mode of the request: lower
+ * case command letter - BCC follows ETX. Data is hex ASCII, so ETX ends the
+ * body of every response type, blocks are decoded by
+ * xgb_parse_read_response.
+ */
+static bool parse_received_byte(xgb_channel_t *p_channel, uint8_t byte)
 {
-  // prepare message - fill union with 0s
-  u_frame temp_frame = {0};
-  xgb_comm_err_t comm_status = XGB_OK;
-  ;
+  switch (p_channel->rx_state)
+    {
+    case (RX_PARSE_HEADER):
+      restart_parser(p_channel, byte);
+      return false;
+
+    case (RX_PARSE_STATION):
+      if (0 == isxdigit(byte))
+        {
+          restart_parser(p_channel, byte);
+          return false;
+        }
+
+      if (RESPONSE_STATION_END == p_channel->rx_frame_lenght + 1U)
+        {
+          p_channel->rx_state = RX_PARSE_COMMAND;
+        }
+      break;
+
+    case (RX_PARSE_COMMAND):
+      if (0 == isalpha(byte))
+        {
+          restart_parser(p_channel, byte);
+          return false;
+        }
 
-  temp_frame.ind_write_frame.header_enq = XGB_CC_ENQ;
+      p_channel->rx_with_bcc = (0 != (byte & LOWER_CASE_BIT));
+      p_channel->rx_state = RX_PARSE_BODY;
+      break;
 
-  // station number
-  temp_frame.ind_write_frame.station_number[0] =
-      (params->ind_write.station_number / 16) + '0';
-  temp_frame.ind_write_frame.station_number[1] =
-      (params->ind_write.station_number % 16) + '0';
+    case (RX_PARSE_BODY):
+      // frame too long - it is not a valid response, start over
+      if (p_channel->rx_frame_lenght >= (MAX_FRAME_SIZE - 1))
+        {
+          restart_parser(p_channel, byte);
+          return false;
+        }
+      break;
 
-  // command
-  temp_frame.ind_write_frame.command = 'W';
+    case (RX_PARSE_BCC):
+      p_channel->rx_bcc_chars[p_channel->rx_bcc_chars_received++] = byte;
 
-  // command type
-  temp_frame.ind_write_frame.command_type[0] = 'S';
-  temp_frame.ind_write_frame.command_type[1] = 'S';
+      if (NO_BCC_CHARS == p_channel->rx_bcc_chars_received)
+        {
+          uint8_t received_bcc;
 
-  // no blocks
-  temp_frame.ind_write_frame.no_blocks[0] =
-      (params->ind_write.no_of_blocks / 16) + '0';
-  temp_frame.ind_write_frame.no_blocks[1] =
-      (params->ind_write.no_of_blocks % 16) + '0';
+          return finish_parsed_frame(
+              p_channel,
+              (true == xgb_codec_get_byte(p_channel->rx_bcc_chars,
+                                          &received_bcc) &&
+               received_bcc == p_channel->rx_bcc));
+        }
+      return false;
 
-  // device lenght %MW <- this is 3 chars and then we add lenght of address
-  // %MW100 = 3 + strlen("100") = 6
-  temp_frame.ind_write_frame.device_lenght[0] =
-      ((3 + strlen(params->ind_write.p_device_address)) / 16) + '0';
-  temp_frame.ind_write_frame.device_lenght[1] =
-      ((3 + strlen(params->ind_write.p_device_address)) % 16) + '0';
+    default:
+      break;
+    }
 
-  // prepare device name
-  temp_frame.ind_write_frame.device_name[0] = '%';
-  temp_frame.ind_write_frame.device_name[1] =
-      params->ind_write.device_type; // device memory group (P,M,L etc.)
-  temp_frame.ind_write_frame.device_name[2] = params->ind_write.data_size;
-  strcpy((char *restrict)(&temp_frame.ind_read_frame.device_name[3]),
-         (const char *)params->ind_write.p_device_address);
+  if (false == is_echo_byte_valid(p_channel, byte))
+    {
+      p_channel->rx_echo_valid = false;
+    }
 
-  // prepare frame data
-  uint8_t no_bytes_to_copy =
-      params->ind_write.no_of_blocks *
-      (data_marking_to_size(params->ind_write.data_size) * 2);
-  memcpy(temp_frame.ind_write_frame.data, params->ind_write.p_data_buffer,
-         no_bytes_to_copy);
+  p_channel->rx_frame_lenght++;
+  p_channel->rx_bcc += byte;
 
-  for (uint8_t i = 0; i < no_bytes_to_copy; i++)
+  if (XGB_CC_ETX == byte && RX_PARSE_BODY == p_channel->rx_state)
     {
-      temp_frame.ind_write_frame.data[i] += '0';
+      if (true == p_channel->rx_with_bcc)
+        {
+          p_channel->rx_state = RX_PARSE_BCC;
+          p_channel->rx_bcc_chars_received = 0;
+          return false;
+        }
+
+      return finish_parsed_frame(p_channel, true);
     }
 
-  temp_frame.ind_write_frame.tail_eot = XGB_CC_EOT; // EOT
-
-  comm_status = prep_frame(&temp_frame, destination);
-  return comm_status;
-}
-
-static xgb_comm_err_t prep_cont_read_frame(u_frame *destination,
-                                           const cmd_frame_data *params)
+  return false;
+}
+
+/*
+ * Bytes of the broken frame become line noise, the byte that broke it can
+ * be the header of the next frame
+ */
+static void restart_parser(xgb_channel_t *p_channel, uint8_t byte)
 {
-  u_frame temp_frame = {0};
-  xgb_comm_err_t comm_status = XGB_OK;
+  p_channel->rx_noise_lenght += p_channel->rx_frame_lenght;
+  p_channel->rx_frame_lenght = 0;
+  p_channel->rx_state = RX_PARSE_HEADER;
 
-  temp_frame.cont_read_frame.header_enq = XGB_CC_ENQ; // ENQ
+  if (true == is_response_header(byte))
+    {
+      p_channel->rx_state = RX_PARSE_STATION;
+      p_channel->rx_frame_lenght = 1;
+      p_channel->rx_bcc = byte;
+      p_channel->rx_echo_valid = true;
+    }
+  else
+    {
+      p_channel->rx_noise_lenght++;
+    }
 
-  temp_frame.cont_read_frame.station_number[0] =
-      (params->cont_read.station_number / 16) + '0';
-  temp_frame.cont_read_frame.station_number[1] =
-      (params->cont_read.station_number % 16) + '0';
+  return;
+}
 
-  temp_frame.cont_read_frame.command = 'R';
+/*
+ * Frame that nobody waits for (late response after timeout or cancel) or
+ * that answers other station / command is dropped as line noise - it would
+ * be taken as the response of the next request otherwise
+ */
+static bool finish_parsed_frame(xgb_channel_t *p_channel, bool bcc_valid)
+{
+  xgb_rx_event_t event = {
+      .noise_lenght = p_channel->rx_noise_lenght,
+      .frame_lenght = p_channel->rx_frame_lenght,
+      .tail_lenght = (true == p_channel->rx_with_bcc) ? NO_BCC_CHARS : 0U,
+      .bcc_valid = bcc_valid};
 
-  temp_frame.cont_read_frame.command_type[0] = 'S';
-  temp_frame.cont_read_frame.command_type[1] = 'B';
+  if (false == is_response_expected(p_channel))
+    {
+      p_channel->rx_noise_lenght += event.frame_lenght + event.tail_lenght;
+      p_channel->rx_frame_lenght = 0;
+      p_channel->rx_state = RX_PARSE_HEADER;
+      p_channel->rx_with_bcc = false;
+      return false;
+    }
 
-  // device lenght %MW <- this is 3 chars and then we add lenght of address
-  // %MW100 = 3 + strlen("100") = 6
-  temp_frame.cont_read_frame.device_lenght[0] =
-      ((3 + strlen(params->cont_read.p_device_address)) / 16) + '0';
-  temp_frame.cont_read_frame.device_lenght[1] =
-      ((3 + strlen(params->cont_read.p_device_address)) % 16) + '0';
+  // main loop that does not keep up loses the frame, request times out
+  RB_Write(&p_channel->rx_event_queue, &event);
+  reset_parser(p_channel);
 
-  // prepare device name
-  temp_frame.cont_read_frame.device_name[0] = '%';
-  temp_frame.cont_read_frame.device_name[1] =
-      params->cont_read.device_type; // device memory group (P,M,L etc.)
-  temp_frame.cont_read_frame.device_name[2] = params->cont_read.data_size;
-  strcpy((char *restrict)(&temp_frame.cont_read_frame.device_name[3]),
-         (const char *)params->cont_read.p_device_address);
+  return true;
+}
 
-  // no of data
-  temp_frame.cont_read_frame.no_data[0] =
-      (params->cont_read.no_of_data / 16) + '0';
-  temp_frame.cont_read_frame.no_data[1] =
-      (params->cont_read.no_of_data % 16) + '0';
+/*
+ * Request is out and its response not taken yet, frame echoes its header
+ */
+static bool is_response_expected(const xgb_channel_t *p_channel)
+{
+  return (true == p_channel->rx_awaiting_response &&
+          false == p_channel->tx_queued && false == p_channel->tx_busy &&
+          true == p_channel->rx_echo_valid &&
+          p_channel->rx_frame_lenght >= RESPONSE_ECHO_END);
+}
 
-  temp_frame.cont_read_frame.tail_eot = XGB_CC_EOT; // EOT
+/*
+ * Bytes after the header are compared with the request on the wire: ENQ is
+ * replaced by ACK/NAK, the rest of the header comes back unchanged
+ */
+static bool is_echo_byte_valid(const xgb_channel_t *p_channel, uint8_t byte)
+{
+  const xgb_tx_slot_t *p_slot = &p_channel->tx_slots[p_channel->tx_active];
+  uint16_t index = p_channel->rx_frame_lenght;
 
-  // trimm message
-  comm_status = prep_frame(&temp_frame, destination);
-  return comm_status;
+  if (index >= RESPONSE_ECHO_END)
+    {
+      return true;
+    }
+
+  return (toupper(byte) == toupper(p_slot->frame[index]));
+}
+
+static void reset_parser(xgb_channel_t *p_channel)
+{
+  p_channel->rx_state = RX_PARSE_HEADER;
+  p_channel->rx_noise_lenght = 0;
+  p_channel->rx_frame_lenght = 0;
+  p_channel->rx_with_bcc = false;
+  p_channel->rx_echo_valid = false;
+
+  return;
+}
+
+/*
+ * Called with interrupts off. Ring buffer starts over at the DMA position -
+ * after an overrun Head is behind it. Response lost in the overrun ends as
+ * timeout.
+ */
+static void drop_received(xgb_channel_t *p_channel)
+{
+  RB_Init(&p_channel->rx_ring_buffer, p_channel->rx_buffer, sizeof(uint8_t),
+          RX_BUFFER_SIZE);
+  RB_Commit(&p_channel->rx_ring_buffer, p_channel->rx_dma_position);
+  RB_Flush(&p_channel->rx_ring_buffer);
+  RB_Flush(&p_channel->rx_event_queue);
+  reset_parser(p_channel);
+  p_channel->rx_overrun = false;
+
+  return;
+}
+
+/*
+ * Noise in front of the frame being parsed is not needed any more, only the
+ * consumer side may free it. Data lost in an overrun is dropped here too.
+ */
+static void drop_line_noise(xgb_channel_t *p_channel)
+{
+  __disable_irq();
+
+  if (true == p_channel->rx_overrun)
+    {
+      drop_received(p_channel);
+    }
+
+  if (0 == RB_Count(&p_channel->rx_event_queue))
+    {
+      RB_Consume(&p_channel->rx_ring_buffer, p_channel->rx_noise_lenght);
+      p_channel->rx_noise_lenght = 0;
+    }
+
+  __enable_irq();
+
+  return;
 }
 
 /*
- * Prepare frame - request of continuous write
+ * Called with interrupts off - response is complete, armed request is
+ * queued and goes out once the station has released the line
  */
-static xgb_comm_err_t prep_cont_write_frame(u_frame *destination,
-                                            const cmd_frame_data *params)
+static void fire_armed_request(xgb_channel_t *p_channel)
 {
-  // prepare message - fill union with 0s
-  u_frame temp_frame = {0};
-  xgb_comm_err_t comm_status = XGB_OK;
+  if (false == p_channel->tx_armed)
+    {
+      return;
+    }
 
-  // header
-  temp_frame.cont_write_frame.header_enq = XGB_CC_ENQ; // ENQ
+  p_channel->tx_armed = false;
+  p_channel->tx_active ^= 1U;
+  p_channel->rx_awaiting_response = true;
+  p_channel->tx_queued = true;
 
-  // station number
-  temp_frame.cont_write_frame.station_number[0] =
-      (params->cont_write.station_number / 16) + '0';
-  temp_frame.cont_write_frame.station_number[1] =
-      (params->cont_write.station_number % 16) + '0';
+  return;
+}
 
-  // command
-  temp_frame.cont_write_frame.command = 'W';
+/*
+ * Response is over but the interrupt did not fire the armed request (it
+ * lost the frame start in line noise or the response timed out) - request
+ * goes out the usual way after bus turnaround
+ */
+static void release_armed_request(xgb_channel_t *p_channel)
+{
+  __disable_irq();
+  fire_armed_request(p_channel);
+  __enable_irq();
 
-  // command type
-  temp_frame.cont_write_frame.command_type[0] = 'S';
-  temp_frame.cont_write_frame.command_type[1] = 'B';
+  return;
+}
 
-  // device lenght %MW <- this is 3 chars and then we add lenght of address
-  // %MW100 = 3 + strlen("100") = 6
-  temp_frame.cont_write_frame.device_lenght[0] =
-      ((3 + strlen(params->cont_write.p_device_address)) / 16) + '0';
-  temp_frame.cont_write_frame.device_lenght[1] =
-      ((3 + strlen(params->cont_write.p_device_address)) % 16) + '0';
+/*
+ * HAL refuses the transfer if the handle is locked by the main loop just
+ * now - request stays queued then and xgb_channel_service sends it
+ */
+static void start_transmit(xgb_channel_t *p_channel)
+{
+  xgb_tx_slot_t *p_slot = &p_channel->tx_slots[p_channel->tx_active];
 
-  // prepare device name
-  temp_frame.cont_write_frame.device_name[0] = '%';
-  temp_frame.cont_write_frame.device_name[1] =
-      params->cont_write.device_type; // device memory group (P,M,L etc.)
-  temp_frame.cont_write_frame.device_name[2] = params->cont_write.data_size;
-  strcpy((char *restrict)(&temp_frame.cont_write_frame.device_name[3]),
-         (const char *)params->cont_write.p_device_address);
+  p_channel->tx_busy = true;
 
-  // no of data
-  temp_frame.cont_write_frame.no_data[0] =
-      (params->cont_write.no_of_data / 16) + '0';
-  temp_frame.cont_write_frame.no_data[1] =
-      (params->cont_write.no_of_data % 16) + '0';
+  if (HAL_OK ==
+      HAL_UART_Transmit_DMA(p_channel->p_huart, p_slot->frame, p_slot->lenght))
+    {
+      p_channel->tx_queued = false;
+    }
+  else
+    {
+      p_channel->tx_busy = false;
+    }
 
-  // prepare frame data
-  uint8_t no_bytes_to_copy =
-      params->cont_write.no_of_data *
-      (data_marking_to_size(params->cont_write.data_size) * 2);
+  return;
+}
 
-  memcpy(temp_frame.cont_write_frame.data, params->cont_write.p_data_buffer,
-         no_bytes_to_copy);
+/*
+ * Main loop and SysTick both send queued requests, the check and the start
+ * of DMA are one step. Transceiver switches direction by itself, so the
+ * bus has to be idle for the turnaround time (one tick more, tick could be
+ * just about to change).
+ */
+static void send_if_bus_free(xgb_channel_t *p_channel)
+{
+  __disable_irq();
 
-  for (uint8_t i = 0; i < no_bytes_to_copy; i++)
+  if (true == p_channel->tx_queued && false == p_channel->tx_busy &&
+      HAL_GetTick() - p_channel->rx_last_activity_tick >
+          XGB_BUS_TURNAROUND_MS)
     {
-      temp_frame.cont_write_frame.data[i] += '0';
+      start_transmit(p_channel);
     }
 
-  temp_frame.cont_write_frame.tail_eot = XGB_CC_EOT; // EOT
+  __enable_irq();
 
-  // trimm message
-  comm_status = prep_frame(&temp_frame, destination);
-  return comm_status;
+  return;
 }
 
-static xgb_comm_err_t send_specific_cmd(const cmd_frame_data *p_frame_data,
-                                        prep_frame_ID ID)
+static xgb_tx_slot_t *tx_build_slot(xgb_channel_t *p_channel)
 {
+  return &p_channel->tx_slots[p_channel->tx_active ^ 1U];
+}
 
-  const static prep_fun_mapper_t prep_fun_mapper[] = {
-      {INDIVI_READ, prep_indivi_read_frame},
-      {CONT_READ, prep_cont_read_frame},
-      {INDIVI_WRITE, prep_indivi_write_frame},
-      {CONT_WRITE, prep_cont_write_frame}};
+static bool is_response_header(uint8_t byte)
+{
+  return (XGB_CC_ACK == byte || XGB_CC_NAK == byte);
+}
 
-  xgb_comm_err_t status = XGB_OK;
-  u_frame frame;
+static uint16_t get_device_name_lenght(const xgb_device_t *p_device)
+{
+  return DEVICE_NAME_OVERHEAD + (uint16_t)strlen(p_device->p_address);
+}
+
+/*
+ * Request is serialized straight into the channel TX frame, BCC is summed on
+ * the way.
+ * With BCC the command letter is sent in lower case.
+ */
+static void tx_start(xgb_channel_t *p_channel, uint8_t station_number,
+                     uint8_t command)
+{
+  p_channel->tx_use_bcc = xgb_station_is_bcc_enabled(station_number);
+  tx_build_slot(p_channel)->lenght = 0;
+  p_channel->tx_bcc = 0;
+  p_channel->tx_overflow = false;
+
+  tx_put_char(p_channel, XGB_CC_ENQ);
+  tx_put_hex(p_channel, station_number, 1);
+  tx_put_char(p_channel, (true == p_channel->tx_use_bcc)
+                             ? (command | LOWER_CASE_BIT)
+                             : command);
+
+  return;
+}
 
-  status = prep_fun_mapper[ID].function(&frame, p_frame_data);
+/*
+ * Nothing is written past the frame, request that does not fit is marked
+ * and refused by tx_finish_and_send
+ */
+static void tx_put_char(xgb_channel_t *p_channel, uint8_t character)
+{
+  xgb_tx_slot_t *p_slot = tx_build_slot(p_channel);
 
-  if (XGB_OK == status)
+  if (p_slot->lenght >= MAX_FRAME_SIZE)
     {
-      uint32_t len = (uint32_t)strlen((char *)frame.frame_bytes);
-      status = send_frame((uint8_t *)&frame.frame_bytes, len);
+      p_channel->tx_overflow = true;
+      return;
     }
 
-  return status;
+  p_slot->frame[p_slot->lenght++] = character;
+  p_channel->tx_bcc += character;
+
+  return;
+}
+
+static void tx_put_hex(xgb_channel_t *p_channel, uint32_t value,
+                       uint8_t no_bytes)
+{
+  xgb_tx_slot_t *p_slot = tx_build_slot(p_channel);
+  uint8_t *p_start = &p_slot->frame[p_slot->lenght];
+  uint8_t *p_end;
+
+  // two hex chars per byte, sizes other than 2, 4, 8 are put as one byte
+  if (p_slot->lenght + 2U * ((no_bytes > 1U) ? no_bytes : 1U) >
+      MAX_FRAME_SIZE)
+    {
+      p_channel->tx_overflow = true;
+      return;
+    }
+
+  p_end = xgb_codec_put_value(p_start, value, no_bytes);
+
+  p_slot->lenght += (uint16_t)(p_end - p_start);
+
+  while (p_start < p_end)
+    {
+      p_channel->tx_bcc += *p_start++;
+    }
+
+  return;
+}
+
+/*
+ * no blocks|(lenght|device name) x blocks
+ */
+static void tx_put_device_blocks(xgb_channel_t *p_channel,
+                                 const xgb_device_t *p_devices,
+                                 uint8_t no_of_devices)
+{
+  tx_put_hex(p_channel, no_of_devices, 1);
+
+  for (uint8_t i = 0; i < no_of_devices; i++)
+    {
+      tx_put_device_name(p_channel, &p_devices[i]);
+    }
+
+  return;
+}
+
+/*
+ * lenght|device name
+ */
+static void tx_put_device_name(xgb_channel_t *p_channel,
+                               const xgb_device_t *p_device)
+{
+  // %MW + address, e.g. %MW100 = 3 + strlen("100") = 6
+  uint8_t address_lenght = (uint8_t)strlen(p_device->p_address);
+
+  tx_put_hex(p_channel, 3 + address_lenght, 1);
+  tx_put_char(p_channel, '%');
+  tx_put_char(p_channel, p_device->device_type);
+  tx_put_char(p_channel, p_device->size_mark);
+
+  for (uint8_t i = 0; i < address_lenght; i++)
+    {
+      tx_put_char(p_channel, (uint8_t)p_device->p_address[i]);
+    }
+
+  return;
+}
+
+/*
+ * BCC is the lower byte of the sum from ENQ to EOT, sent as hex after EOT.
+ * Request built while the previous one still waits for its response is
+ * armed and leaves one bus turnaround after that response ends. Otherwise
+ * it is queued for xgb_channel_service. Only one request can wait behind
+ * the active one.
+ */
+static xgb_comm_err_t tx_finish_and_send(xgb_channel_t *p_channel)
+{
+  xgb_tx_slot_t *p_slot = tx_build_slot(p_channel);
+
+  tx_put_char(p_channel, XGB_CC_EOT);
+
+  if (true == p_channel->tx_use_bcc &&
+      p_slot->lenght + NO_BCC_CHARS > MAX_FRAME_SIZE)
+    {
+      p_channel->tx_overflow = true;
+    }
+
+  // slot is not active, nothing on the wire is touched
+  if (true == p_channel->tx_overflow)
+    {
+      return XGB_ERR_FRAME;
+    }
+
+  if (true == p_channel->tx_use_bcc)
+    {
+      xgb_codec_put_byte(&p_slot->frame[p_slot->lenght], p_channel->tx_bcc);
+      p_slot->lenght += NO_BCC_CHARS;
+    }
+
+  __disable_irq();
+
+  if (true == p_channel->rx_awaiting_response)
+    {
+      p_channel->tx_armed = true;
+    }
+  else
+    {
+      p_channel->tx_active ^= 1U;
+      p_channel->tx_queued = true;
+      p_channel->rx_awaiting_response = true;
+    }
+
+  __enable_irq();
+
+  xgb_channel_service(p_channel);
+
+  return XGB_OK;
 }
 
 static uint8_t data_marking_to_size(xgb_data_size_marking_t data_size)
@@ -0,0 +1,183 @@
+/*
+ * xgb_monitor.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: pawel
+ */
+
+#include "xgb_monitor.h"
+
+#include "stddef.h"
+
+/*
+ * Monitor register of one fixed group of devices. Groups are made by the
+ * caller after every change of config, the device list of a slot never
+ * changes until the next xgb_monitor_reset.
+ */
+typedef struct monitor_slot
+{
+  xgb_monitor_state_t state;
+  uint8_t station_number;
+  uint8_t register_number;
+  uint8_t failures;
+} monitor_slot_t;
+
+static monitor_slot_t monitor_slots[XGB_MONITOR_SLOTS];
+
+static monitor_slot_t *get_slot(uint8_t slot);
+
+/*
+ * Groups are made again - all registers are free and registered again
+ * before their first execute
+ */
+void xgb_monitor_reset(void)
+{
+  for (uint8_t slot = 0; slot < XGB_MONITOR_SLOTS; slot++)
+    {
+      monitor_slots[slot].state = XGB_MONITOR_FREE;
+    }
+
+  return;
+}
+
+/*
+ * Slot for the next group of the station, registers of the station are
+ * numbered in the order of its groups. Returns XGB_MONITOR_NONE if slots or
+ * registers of the station are used up.
+ */
+uint8_t xgb_monitor_add(uint8_t station_number)
+{
+  uint8_t free_slot = XGB_MONITOR_NONE;
+  uint8_t register_number = 0;
+
+  for (uint8_t slot = 0; slot < XGB_MONITOR_SLOTS; slot++)
+    {
+      const monitor_slot_t *p_slot = &monitor_slots[slot];
+
+      if (XGB_MONITOR_FREE == p_slot->state)
+        {
+          if (XGB_MONITOR_NONE == free_slot)
+            {
+              free_slot = slot;
+            }
+        }
+      else if (station_number == p_slot->station_number)
+        {
+          register_number++;
+        }
+    }
+
+  if (XGB_MONITOR_NONE == free_slot ||
+      register_number > XGB_MAX_MONITOR_REGISTER)
+    {
+      return XGB_MONITOR_NONE;
+    }
+
+  monitor_slots[free_slot].state = XGB_MONITOR_UNREGISTERED;
+  monitor_slots[free_slot].station_number = station_number;
+  monitor_slots[free_slot].register_number = register_number;
+  monitor_slots[free_slot].failures = 0;
+
+  return free_slot;
+}
+
+/*
+ * Group without slot is always read with RSS (XGB_MONITOR_FREE)
+ */
+xgb_monitor_state_t xgb_monitor_get(uint8_t slot, uint8_t *p_register_number)
+{
+  const monitor_slot_t *p_slot = get_slot(slot);
+
+  if (NULL == p_slot)
+    {
+      return XGB_MONITOR_FREE;
+    }
+
+  *p_register_number = p_slot->register_number;
+
+  return p_slot->state;
+}
+
+/*
+ * Result of X command - NAK means PLC does not take this group, it is read
+ * with plain RSS from now on
+ */
+void xgb_monitor_registered(uint8_t slot, bool accepted)
+{
+  monitor_slot_t *p_slot = get_slot(slot);
+
+  if (NULL == p_slot)
+    {
+      return;
+    }
+
+  p_slot->state =
+      (true == accepted) ? XGB_MONITOR_REGISTERED : XGB_MONITOR_REJECTED;
+
+  return;
+}
+
+/*
+ * Result of Y command. NAK - PLC lost the register (e.g. restart), register
+ * it again, but not forever. Only failures in a row count, every PLC
+ * restart during the uptime costs one.
+ */
+void xgb_monitor_executed(uint8_t slot, bool accepted)
+{
+  monitor_slot_t *p_slot = get_slot(slot);
+
+  if (NULL == p_slot)
+    {
+      return;
+    }
+
+  if (true == accepted)
+    {
+      p_slot->failures = 0;
+      return;
+    }
+
+  p_slot->failures++;
+
+  if (p_slot->failures >= XGB_MONITOR_MAX_FAILURES)
+    {
+      p_slot->state = XGB_MONITOR_REJECTED;
+    }
+  else
+    {
+      p_slot->state = XGB_MONITOR_UNREGISTERED;
+    }
+
+  return;
+}
+
+/*
+ * Station was offline - it could be restarted, so register everything again
+ */
+void xgb_monitor_invalidate_station(uint8_t station_number)
+{
+  for (uint8_t slot = 0; slot < XGB_MONITOR_SLOTS; slot++)
+    {
+      monitor_slot_t *p_slot = &monitor_slots[slot];
+
+      if (XGB_MONITOR_FREE != p_slot->state &&
+          station_number == p_slot->station_number)
+        {
+          p_slot->state = XGB_MONITOR_UNREGISTERED;
+          p_slot->failures = 0;
+        }
+    }
+
+  return;
+}
+
+static monitor_slot_t *get_slot(uint8_t slot)
+{
+  if (slot >= XGB_MONITOR_SLOTS ||
+      XGB_MONITOR_FREE == monitor_slots[slot].state)
+    {
+      return NULL;
+    }
+
+  return &monitor_slots[slot];
+}
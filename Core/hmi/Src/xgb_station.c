@@ -0,0 +1,377 @@
+/*
+ * xgb_station.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: pawel
+ */
+
+#include "xgb_station.h"
+
+#include "main.h"
+#include "stddef.h"
+
+/*
+ * Round trip time estimator in TCP RTO style (RFC 6298), kept in fixed
+ * point: srtt is scaled by 8 and rttvar by 4, so gains 1/8 and 1/4 are just
+ * shifts. Timeout = srtt + 4 * rttvar. Answer in under 1 ms gives srtt 0,
+ * so the first sample is marked by has_sample.
+ */
+typedef struct rtt_estimator
+{
+  bool has_sample;
+  uint16_t srtt_x8;
+  uint16_t rttvar_x4;
+  uint16_t rto_ms;
+} rtt_estimator_t;
+
+/*
+ * Circuit breaker - after XGB_STATION_FAIL_LIMIT timeouts in a row the
+ * station goes offline and is probed with exponential backoff
+ */
+typedef struct station_health
+{
+  bool offline;
+  uint8_t consecutive_timeouts;
+  uint16_t probe_backoff_ms;
+  uint32_t next_probe_tick;
+} station_health_t;
+
+typedef struct station_stats
+{
+  bool in_use;
+  uint8_t station_number;
+  bool bcc_enabled;
+  station_health_t health;
+  rtt_estimator_t rtt[XGB_NO_FRAME_TYPES];
+} station_stats_t;
+
+static station_stats_t stations[XGB_MAX_STATIONS];
+
+static station_stats_t *find_station(uint8_t station_number);
+static station_stats_t *get_or_add_station(uint8_t station_number);
+static rtt_estimator_t *get_estimator(station_stats_t *p_station,
+                                      xgb_frame_type_t frame_type);
+static uint16_t clamp_rto(uint32_t rto_ms);
+static void mark_station_alive(station_stats_t *p_station);
+static void mark_station_timeout(station_stats_t *p_station);
+
+/*
+ * reply_ms is the time of the expected response on the wire at the link
+ * speed - samples of short responses do not cut a long one
+ */
+uint32_t xgb_station_get_timeout(uint8_t station_number,
+                                 xgb_frame_type_t frame_type,
+                                 uint32_t reply_ms)
+{
+  rtt_estimator_t *p_rtt =
+      get_estimator(find_station(station_number), frame_type);
+  uint32_t floor_ms = reply_ms + XGB_RTO_INITIAL_MS;
+
+  if (NULL == p_rtt)
+    {
+      return floor_ms;
+    }
+
+  if (true == p_rtt->has_sample)
+    {
+      floor_ms = reply_ms + XGB_RTO_MIN_MS;
+    }
+
+  // backoff after timeouts still counts
+  return (p_rtt->rto_ms > floor_ms) ? p_rtt->rto_ms : floor_ms;
+}
+
+/*
+ * Only call with times of answered requests - a response that came after
+ * retry could belong to either request (Karn's rule)
+ */
+void xgb_station_rtt_sample(uint8_t station_number, xgb_frame_type_t frame_type,
+                            uint32_t rtt_ms)
+{
+  station_stats_t *p_station = get_or_add_station(station_number);
+  rtt_estimator_t *p_rtt = get_estimator(p_station, frame_type);
+
+  // any answer (even NAK) means the station is alive
+  mark_station_alive(p_station);
+
+  if (NULL == p_rtt)
+    {
+      return;
+    }
+
+  if (rtt_ms > XGB_RTO_MAX_MS)
+    {
+      rtt_ms = XGB_RTO_MAX_MS;
+    }
+
+  if (false == p_rtt->has_sample)
+    {
+      p_rtt->has_sample = true;
+      p_rtt->srtt_x8 = (uint16_t)(rtt_ms << 3);
+      p_rtt->rttvar_x4 = (uint16_t)(rtt_ms << 1);
+    }
+  else
+    {
+      int32_t error = (int32_t)rtt_ms - (p_rtt->srtt_x8 >> 3);
+
+      // srtt += error / 8
+      p_rtt->srtt_x8 = (uint16_t)((int32_t)p_rtt->srtt_x8 + error);
+
+      // rttvar += (|error| - rttvar) / 4
+      if (error < 0)
+        {
+          error = -error;
+        }
+      p_rtt->rttvar_x4 = (uint16_t)((int32_t)p_rtt->rttvar_x4 + error -
+                                    (p_rtt->rttvar_x4 >> 2));
+    }
+
+  p_rtt->rto_ms = clamp_rto((p_rtt->srtt_x8 >> 3) + p_rtt->rttvar_x4);
+
+  return;
+}
+
+/*
+ * No response - back off so a slow station is not timed out over and over,
+ * next valid sample brings the timeout back
+ */
+void xgb_station_timeout(uint8_t station_number, xgb_frame_type_t frame_type)
+{
+  station_stats_t *p_station = get_or_add_station(station_number);
+  rtt_estimator_t *p_rtt = get_estimator(p_station, frame_type);
+
+  mark_station_timeout(p_station);
+
+  if (NULL == p_rtt)
+    {
+      return;
+    }
+
+  p_rtt->rto_ms = clamp_rto((uint32_t)p_rtt->rto_ms * 2);
+
+  return;
+}
+
+bool xgb_station_is_online(uint8_t station_number)
+{
+  station_stats_t *p_station = find_station(station_number);
+
+  return (NULL == p_station || false == p_station->health.offline);
+}
+
+bool xgb_station_is_probe_due(uint8_t station_number, uint32_t now)
+{
+  station_stats_t *p_station = find_station(station_number);
+
+  if (NULL == p_station || false == p_station->health.offline)
+    {
+      return false;
+    }
+
+  // signed difference survives tick overflow
+  return ((int32_t)(now - p_station->health.next_probe_tick) >= 0);
+}
+
+/*
+ * Tick of the next probe of dead station, current tick for station that is
+ * online
+ */
+uint32_t xgb_station_get_probe_tick(uint8_t station_number)
+{
+  station_stats_t *p_station = find_station(station_number);
+
+  if (NULL == p_station || false == p_station->health.offline)
+    {
+      return HAL_GetTick();
+    }
+
+  return p_station->health.next_probe_tick;
+}
+
+/*
+ * Stations out of the mask (bit n = station n) are polled by no tile, their
+ * slots are free for new stations
+ */
+void xgb_station_release_unused(uint32_t station_mask)
+{
+  for (uint8_t i = 0; i < XGB_MAX_STATIONS; i++)
+    {
+      if (0 == (station_mask & (1UL << stations[i].station_number)))
+        {
+          stations[i].in_use = false;
+        }
+    }
+
+  return;
+}
+
+/*
+ * BCC mode has to match the setting of Cnet module of the station, PLC
+ * ignores frames with the other mode
+ */
+void xgb_station_set_bcc(uint8_t station_number, bool enabled)
+{
+  station_stats_t *p_station = get_or_add_station(station_number);
+
+  if (NULL != p_station)
+    {
+      p_station->bcc_enabled = enabled;
+    }
+
+  return;
+}
+
+bool xgb_station_is_bcc_enabled(uint8_t station_number)
+{
+  station_stats_t *p_station = find_station(station_number);
+
+  if (NULL == p_station)
+    {
+      return XGB_STATION_BCC_DEFAULT;
+    }
+
+  return p_station->bcc_enabled;
+}
+
+static void mark_station_alive(station_stats_t *p_station)
+{
+  if (NULL == p_station)
+    {
+      return;
+    }
+
+  p_station->health.offline = false;
+  p_station->health.consecutive_timeouts = 0;
+  p_station->health.probe_backoff_ms = 0;
+
+  return;
+}
+
+static void mark_station_timeout(station_stats_t *p_station)
+{
+  station_health_t *p_health;
+
+  if (NULL == p_station)
+    {
+      return;
+    }
+
+  p_health = &p_station->health;
+
+  if (p_health->consecutive_timeouts < UINT8_MAX)
+    {
+      p_health->consecutive_timeouts++;
+    }
+
+  if (p_health->consecutive_timeouts < XGB_STATION_FAIL_LIMIT)
+    {
+      return;
+    }
+
+  // first failure or failed probe - next probe later and later
+  if (0 == p_health->probe_backoff_ms)
+    {
+      p_health->probe_backoff_ms = XGB_PROBE_BACKOFF_MIN_MS;
+    }
+  else if (p_health->probe_backoff_ms < XGB_PROBE_BACKOFF_MAX_MS)
+    {
+      p_health->probe_backoff_ms *= 2;
+    }
+
+  if (p_health->probe_backoff_ms > XGB_PROBE_BACKOFF_MAX_MS)
+    {
+      p_health->probe_backoff_ms = XGB_PROBE_BACKOFF_MAX_MS;
+    }
+
+  p_health->offline = true;
+  p_health->next_probe_tick = HAL_GetTick() + p_health->probe_backoff_ms;
+
+  return;
+}
+
+/*
+ * Statistics of the station, NULL if nothing was recorded for it yet -
+ * queries give defaults then and do not take a slot
+ */
+static station_stats_t *find_station(uint8_t station_number)
+{
+  for (uint8_t i = 0; i < XGB_MAX_STATIONS; i++)
+    {
+      if (true == stations[i].in_use &&
+          station_number == stations[i].station_number)
+        {
+          return &stations[i];
+        }
+    }
+
+  return NULL;
+}
+
+/*
+ * Only for recording - take a free slot if the station is a new one
+ */
+static station_stats_t *get_or_add_station(uint8_t station_number)
+{
+  station_stats_t *p_station = find_station(station_number);
+  station_stats_t *p_free = NULL;
+
+  if (NULL != p_station)
+    {
+      return p_station;
+    }
+
+  for (uint8_t i = 0; i < XGB_MAX_STATIONS && NULL == p_free; i++)
+    {
+      if (false == stations[i].in_use)
+        {
+          p_free = &stations[i];
+        }
+    }
+
+  if (NULL == p_free)
+    {
+      return NULL;
+    }
+
+  p_free->in_use = true;
+  p_free->station_number = station_number;
+  p_free->bcc_enabled = XGB_STATION_BCC_DEFAULT;
+  p_free->health.offline = false;
+  p_free->health.consecutive_timeouts = 0;
+  p_free->health.probe_backoff_ms = 0;
+
+  for (uint8_t i = 0; i < XGB_NO_FRAME_TYPES; i++)
+    {
+      p_free->rtt[i].has_sample = false;
+      p_free->rtt[i].srtt_x8 = 0;
+      p_free->rtt[i].rttvar_x4 = 0;
+      p_free->rtt[i].rto_ms = XGB_RTO_INITIAL_MS;
+    }
+
+  return p_free;
+}
+
+static rtt_estimator_t *get_estimator(station_stats_t *p_station,
+                                      xgb_frame_type_t frame_type)
+{
+  if (NULL == p_station || frame_type >= XGB_NO_FRAME_TYPES)
+    {
+      return NULL;
+    }
+
+  return &p_station->rtt[frame_type];
+}
+
+static uint16_t clamp_rto(uint32_t rto_ms)
+{
+  if (rto_ms < XGB_RTO_MIN_MS)
+    {
+      return XGB_RTO_MIN_MS;
+    }
+  else if (rto_ms > XGB_RTO_MAX_MS)
+    {
+      return XGB_RTO_MAX_MS;
+    }
+
+  return (uint16_t)rto_ms;
+}
@@ -6,30 +6,51 @@
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
 ../Core/hmi/Src/hmi.c \
+../Core/hmi/Src/hmi_config.c \
 ../Core/hmi/Src/hmi_draw.c \
 ../Core/hmi/Src/hmi_edit_menu.c \
+../Core/hmi/Src/hmi_event.c \
 ../Core/hmi/Src/hmi_main_menu.c \
 ../Core/hmi/Src/hmi_mock.c \
-../Core/hmi/Src/xgb_comm.c 
+../Core/hmi/Src/hmi_poll.c \
+../Core/hmi/Src/hmi_sched.c \
+../Core/hmi/Src/xgb_codec.c \
+../Core/hmi/Src/xgb_comm.c \
+../Core/hmi/Src/xgb_monitor.c \
+../Core/hmi/Src/xgb_station.c 
 
 OBJS += \
 ./Core/hmi/Src/hmi.o \
+./Core/hmi/Src/hmi_config.o \
 ./Core/hmi/Src/hmi_draw.o \
 ./Core/hmi/Src/hmi_edit_menu.o \
+./Core/hmi/Src/hmi_event.o \
 ./Core/hmi/Src/hmi_main_menu.o \
 ./Core/hmi/Src/hmi_mock.o \
-./Core/hmi/Src/xgb_comm.o 
+./Core/hmi/Src/hmi_poll.o \
+./Core/hmi/Src/hmi_sched.o \
+./Core/hmi/Src/xgb_codec.o \
+./Core/hmi/Src/xgb_comm.o \
+./Core/hmi/Src/xgb_monitor.o \
+./Core/hmi/Src/xgb_station.o 
 
 C_DEPS += \
 ./Core/hmi/Src/hmi.d \
+./Core/hmi/Src/hmi_config.d \
 ./Core/hmi/Src/hmi_draw.d \
 ./Core/hmi/Src/hmi_edit_menu.d \
+./Core/hmi/Src/hmi_event.d \
 ./Core/hmi/Src/hmi_main_menu.d \
 ./Core/hmi/Src/hmi_mock.d \
-./Core/hmi/Src/xgb_comm.d 
+./Core/hmi/Src/hmi_poll.d \
+./Core/hmi/Src/hmi_sched.d \
+./Core/hmi/Src/xgb_codec.d \
+./Core/hmi/Src/xgb_comm.d \
+./Core/hmi/Src/xgb_monitor.d \
+./Core/hmi/Src/xgb_station.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
 Core/hmi/Src/%.o: ../Core/hmi/Src/%.c Core/hmi/Src/subdir.mk
-	arm-none-eabi-gcc "$<" -mcpu=cortex-m3 -std=gnu11 -g3 -DDEBUG -DUSE_HAL_DRIVER -DSTM32F103x6 -c -I../Core/Inc -I../Core/hmi/Inc -I../Drivers/STM32F1xx_HAL_Driver/Inc -I../Drivers/STM32F1xx_HAL_Driver/Inc/Legacy -I../Drivers/CMSIS/Device/ST/STM32F1xx/Include -I../Drivers/CMSIS/Include -O0 -ffunction-sections -fdata-sections -Wall -fstack-usage -MMD -MP -MF"$(@:%.o=%.d)" -MT"$@" --specs=nano.specs -mfloat-abi=soft -mthumb -o "$@"
+	arm-none-eabi-gcc "$<" -mcpu=cortex-m3 -std=gnu11 -g3 -DDEBUG -DUSE_HAL_DRIVER -DSTM32F103x6 -c -I../Core/Inc -I../Core/hmi/Inc -I../Drivers/STM32F1xx_HAL_Driver/Inc -I../Drivers/STM32F1xx_HAL_Driver/Inc/Legacy -I../Drivers/CMSIS/Device/ST/STM32F1xx/Include -I../Drivers/CMSIS/Include -Os -ffunction-sections -fdata-sections -Wall -fstack-usage -MMD -MP -MF"$(@:%.o=%.d)" -MT"$@" --specs=nano.specs -mfloat-abi=soft -mthumb -o "$@"
 